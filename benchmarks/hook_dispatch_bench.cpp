@@ -0,0 +1,180 @@
+// Measures the per-call cost of the exported wrapper dispatch in the shim.
+// Mirrors `export_macros.h` before and after the hook table change so it builds without Win32:
+//  - map: mutex + std::string + tsl::robin_map probe per call (old `find_hook`)
+//  - table: one relaxed atomic load from a dense array indexed by HookId (current `load_hook`)
+// The workload is an immediate-mode loop issuing glColor3f + glVertex3f per vertex.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+
+#include <tsl/robin_map.h>
+
+#ifdef _MSC_VER
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+namespace
+{
+using Proc = void (*)();
+
+enum class HookId : unsigned
+{
+    glBegin,
+    glColor3f,
+    glVertex3f,
+    glEnd,
+    _COUNT,
+};
+
+// Hook bodies only accumulate so the compiler cannot drop the calls
+float g_sink = 0.0f;
+
+void hook_begin(unsigned mode)
+{
+    g_sink += static_cast<float>(mode);
+}
+
+void hook_color3f(float r, float g, float b)
+{
+    g_sink += r + g + b;
+}
+
+void hook_vertex3f(float x, float y, float z)
+{
+    g_sink += x - y + z;
+}
+
+void hook_end()
+{
+    g_sink *= 0.5f;
+}
+
+// old dispatch
+std::mutex g_hook_mutex;
+tsl::robin_map<std::string, Proc> g_hooks;
+
+Proc find_hook(const char* name)
+{
+    std::scoped_lock lock(g_hook_mutex);
+    if (g_hooks.contains(name))
+    {
+        return g_hooks[name];
+    }
+    return nullptr;
+}
+
+// new dispatch
+std::array<std::atomic<Proc>, static_cast<size_t>(HookId::_COUNT)> g_hook_table{};
+
+inline Proc load_hook(const HookId id)
+{
+    return g_hook_table[static_cast<size_t>(id)].load(std::memory_order_relaxed);
+}
+
+#define BENCH_WRAPPER(prefix, lookup, name, params, args)                                          \
+    BENCH_NOINLINE void prefix##_##name params                                                     \
+    {                                                                                              \
+        using FnType = void (*) params;                                                            \
+        if (auto override_fn = reinterpret_cast<FnType>(lookup))                                   \
+        {                                                                                          \
+            override_fn args;                                                                      \
+        }                                                                                          \
+    }
+
+BENCH_WRAPPER(map, find_hook("glBegin"), glBegin, (unsigned mode), (mode))
+BENCH_WRAPPER(map, find_hook("glColor3f"), glColor3f, (float r, float g, float b), (r, g, b))
+BENCH_WRAPPER(map, find_hook("glVertex3f"), glVertex3f, (float x, float y, float z), (x, y, z))
+BENCH_WRAPPER(map, find_hook("glEnd"), glEnd, (), ())
+
+BENCH_WRAPPER(table, load_hook(HookId::glBegin), glBegin, (unsigned mode), (mode))
+BENCH_WRAPPER(table, load_hook(HookId::glColor3f), glColor3f, (float r, float g, float b),
+              (r, g, b))
+BENCH_WRAPPER(table, load_hook(HookId::glVertex3f), glVertex3f, (float x, float y, float z),
+              (x, y, z))
+BENCH_WRAPPER(table, load_hook(HookId::glEnd), glEnd, (), ())
+
+#undef BENCH_WRAPPER
+
+void register_hook(const char* name, const HookId id, const Proc proc)
+{
+    g_hooks[name] = proc;
+    g_hook_table[static_cast<size_t>(id)].store(proc, std::memory_order_relaxed);
+}
+
+struct Wrappers
+{
+    void (*begin)(unsigned);
+    void (*color3f)(float, float, float);
+    void (*vertex3f)(float, float, float);
+    void (*end)();
+};
+
+// Returns nanoseconds per wrapper call
+BENCH_NOINLINE double run(const Wrappers& w, const size_t num_vertices)
+{
+    constexpr size_t k_VERTICES_PER_BATCH = 3 * 1024;  // glBegin(GL_TRIANGLES) .. glEnd
+
+    const auto start = std::chrono::steady_clock::now();
+
+    size_t calls = 0;
+    for (size_t v = 0; v < num_vertices;)
+    {
+        w.begin(0x0004);
+        const size_t batch_end = std::min(num_vertices, v + k_VERTICES_PER_BATCH);
+        for (; v < batch_end; ++v)
+        {
+            const float f = static_cast<float>(v & 0xFF);
+            w.color3f(f, 0.5f, 1.0f);
+            w.vertex3f(f, f * 0.5f, 1.0f);
+            calls += 2;
+        }
+        w.end();
+        calls += 2;
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(calls);
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t num_vertices = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+
+    register_hook("glBegin", HookId::glBegin, reinterpret_cast<Proc>(&hook_begin));
+    register_hook("glColor3f", HookId::glColor3f, reinterpret_cast<Proc>(&hook_color3f));
+    register_hook("glVertex3f", HookId::glVertex3f, reinterpret_cast<Proc>(&hook_vertex3f));
+    register_hook("glEnd", HookId::glEnd, reinterpret_cast<Proc>(&hook_end));
+
+    // pad the map to roughly the number of hooks the shim registers
+    for (int i = 0; i < 160; ++i)
+    {
+        g_hooks["glPadding" + std::to_string(i)] = reinterpret_cast<Proc>(&hook_end);
+    }
+
+    constexpr Wrappers k_MAP = { map_glBegin, map_glColor3f, map_glVertex3f, map_glEnd };
+    constexpr Wrappers k_TABLE = { table_glBegin, table_glColor3f, table_glVertex3f, table_glEnd };
+
+    // warm up caches and branch predictors once for each path
+    run(k_MAP, num_vertices / 10);
+    run(k_TABLE, num_vertices / 10);
+
+    const double map_ns = run(k_MAP, num_vertices);
+    const double table_ns = run(k_TABLE, num_vertices);
+
+    std::printf("hook dispatch, %zu vertices (glColor3f + glVertex3f each)\n", num_vertices);
+    std::printf("  mutex + robin_map : %8.2f ns/call\n", map_ns);
+    std::printf("  atomic hook table : %8.2f ns/call\n", table_ns);
+    std::printf("  speedup           : %8.2fx\n", map_ns / table_ns);
+    std::printf("  (sink %f)\n", static_cast<double>(g_sink));
+
+    return 0;
+}
@@ -0,0 +1,521 @@
+// Measures IPCProtocol throughput and frame hand-off latency with synthetic command mixes.
+// The writer thread records frames with `write_command` / `write_simple` the same way the shim
+// does, the reader thread leases and walks them the way `glDriver` does (without decoding).
+//  - gears: one glxgears frame, matrix calls around three `glCallList`s
+//  - immediate: glBegin/glColor3f/glNormal3f/glVertex3f/glEnd, tiny records
+//  - immediate_reserve: the same records built in place with `reserve` / `commit`
+//  - vertex_batch: the same calls gathered into one GLREMIXCMD_VERTEX_BATCH like the shim does
+//  - draw_elements: GLREMIXCMD_DRAW_ELEMENTS with position/color/normal arrays and indices
+//  - tex_image: GLCMD_TEX_IMAGE_2D uploads, large enough to go through overflow segments
+//  - *_bulk: the same payloads placed in the bulk arena, the ring only carries the commands
+//  - *_window: the bulk mixes with the writer mapping the arena through a 4 MB window, as 32-bit
+//    shims do; `remaps` counts how often the view moved
+//  - *_publisher: the writer records into its thread buffer and a publisher thread copies each
+//    frame into the ring (`IPCProtocol::start_publisher`); the *_bulk_publisher mixes ask for
+//    bulk space but get none, so their payloads go inline
+// Ring KB/frame is the size of the command stream without the bulk payloads.
+// Game time is what recording plus `end_frame` costs the writer thread per frame.
+// Hand-off latency is the time from `end_frame` on the writer to the reader seeing the frame end.
+// Spin/sleep counts how many waits on either side were resolved by spinning vs. the signal.
+// The first frame section starts both sides from fresh mappings, with and without
+// `IPCMapOptions` warmup, and times setup plus the first two frames (payloads read by the reader).
+
+#include <shared/hash_utils.h>
+#include <shared/ipc_protocol.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct Mix
+{
+    const char* name;
+    UINT32 frames;
+    void (*record)(glRemix::IPCProtocol& ipc, UINT64& commands);
+    UINT32 bulk_window = 0;  // see `IPCProtocol::set_bulk_window`
+    bool publisher = false;  // see `IPCProtocol::start_publisher`
+};
+
+// what glxgears records per frame once its gears are compiled into display lists
+void record_gears(glRemix::IPCProtocol& ipc, UINT64& commands)
+{
+    using namespace glRemix;
+    ipc.write_command<GLCommandType::GLCMD_CLEAR>(GLClearCommand{ 0x4100 });
+    ipc.write_command<GLCommandType::GLCMD_PUSH_MATRIX>(GLPushMatrixCommand{});
+    ipc.write_command<GLCommandType::GLCMD_ROTATE>(GLRotateCommand{ 20.0f, { 1.0f, 0.0f, 0.0f } });
+    ipc.write_command<GLCommandType::GLCMD_ROTATE>(GLRotateCommand{ 30.0f, { 0.0f, 1.0f, 0.0f } });
+    ipc.write_command<GLCommandType::GLCMD_ROTATE>(GLRotateCommand{ 0.0f, { 0.0f, 0.0f, 1.0f } });
+    for (UINT32 gear = 1; gear <= 3; gear++)
+    {
+        ipc.write_command<GLCommandType::GLCMD_PUSH_MATRIX>(GLPushMatrixCommand{});
+        ipc.write_command<GLCommandType::GLCMD_TRANSLATE>(
+            GLTranslateCommand{ { -3.0f, -2.0f, 0.0f } });
+        ipc.write_command<GLCommandType::GLCMD_ROTATE>(
+            GLRotateCommand{ 1.0f, { 0.0f, 0.0f, 1.0f } });
+        ipc.write_command<GLCommandType::GLCMD_CALL_LIST>(GLCallListCommand{ gear });
+        ipc.write_command<GLCommandType::GLCMD_POP_MATRIX>(GLPopMatrixCommand{});
+    }
+    ipc.write_command<GLCommandType::GLCMD_POP_MATRIX>(GLPopMatrixCommand{});
+    commands += 21;
+}
+
+void record_immediate(glRemix::IPCProtocol& ipc, UINT64& commands)
+{
+    constexpr UINT32 k_VERTICES = 8 * 1024;
+
+    using namespace glRemix;
+    ipc.write_command<GLCommandType::GLCMD_BEGIN>(GLBeginCommand{ 0x0004 });
+    for (UINT32 v = 0; v < k_VERTICES; v++)
+    {
+        const float f = static_cast<float>(v & 0xFF);
+        ipc.write_command<GLCommandType::GLCMD_COLOR3F>(GLColor3fCommand{ f, 0.5f, 1.0f });
+        ipc.write_command<GLCommandType::GLCMD_NORMAL3F>(GLNormal3fCommand{ 0.0f, 0.0f, 1.0f });
+        ipc.write_command<GLCommandType::GLCMD_VERTEX3F>(GLVertex3fCommand{ f, f * 0.5f, 1.0f });
+    }
+    ipc.write_command<GLCommandType::GLCMD_END>(GLEndCommand{});
+    commands += 3 * k_VERTICES + 2;
+}
+
+// Same records as `record_immediate`, with the fields stored straight into the ring
+void record_immediate_reserve(glRemix::IPCProtocol& ipc, UINT64& commands)
+{
+    constexpr UINT32 k_VERTICES = 8 * 1024;
+
+    using namespace glRemix;
+    ipc.reserve<GLCommandType::GLCMD_BEGIN>()->mode = 0x0004;
+    ipc.commit();
+    for (UINT32 v = 0; v < k_VERTICES; v++)
+    {
+        const float f = static_cast<float>(v & 0xFF);
+        *ipc.reserve<GLCommandType::GLCMD_COLOR3F>() = { f, 0.5f, 1.0f };
+        ipc.commit();
+        *ipc.reserve<GLCommandType::GLCMD_NORMAL3F>() = { 0.0f, 0.0f, 1.0f };
+        ipc.commit();
+        *ipc.reserve<GLCommandType::GLCMD_VERTEX3F>() = { f, f * 0.5f, 1.0f };
+        ipc.commit();
+    }
+    *ipc.reserve<GLCommandType::GLCMD_END>() = {};
+    ipc.commit();
+    commands += 3 * k_VERTICES + 2;
+}
+
+// Same calls as `record_immediate`, gathered the way `hooks::GLVertexBatch` does
+void record_vertex_batch(glRemix::IPCProtocol& ipc, UINT64& commands)
+{
+    constexpr UINT32 k_VERTICES = 8 * 1024;
+
+    using namespace glRemix;
+    static std::vector<GLVec3f> positions;
+    static std::vector<GLVec4f> colors;
+    static std::vector<GLVec3f> normals;
+    positions.clear();
+    colors.clear();
+    normals.clear();
+    for (UINT32 v = 0; v < k_VERTICES; v++)
+    {
+        const float f = static_cast<float>(v & 0xFF);
+        colors.push_back({ f, 0.5f, 1.0f, 1.0f });
+        normals.push_back({ 0.0f, 0.0f, 1.0f });
+        positions.push_back({ f, f * 0.5f, 1.0f });
+    }
+
+    const GLRemixVertexBatchCommand batch{
+        .mode = 0x0004,
+        .count = k_VERTICES,
+        .attributes = 1u << static_cast<UINT32>(GLRemixVertexAttribute::COLOR)
+                      | 1u << static_cast<UINT32>(GLRemixVertexAttribute::NORMAL),
+        .first = { 0, 0, 0 },
+        .color = colors.back(),
+        .normal = normals.back(),
+        .uv = {},
+    };
+    const auto bytes = [](const auto& values)
+    { return static_cast<UINT32>(values.size() * sizeof(values[0])); };
+
+    ipc.write_command<GLCommandType::GLREMIXCMD_VERTEX_BATCH>(
+        batch, bytes(positions) + bytes(colors) + bytes(normals), false, nullptr);
+    ipc.write_simple(positions.data(), bytes(positions));
+    ipc.write_simple(colors.data(), bytes(colors));
+    ipc.write_simple(normals.data(), bytes(normals));
+    commands += 3 * k_VERTICES + 2;
+}
+
+// keeps hashes the bench computes but never sends from being optimized out
+volatile UINT64 g_hash_sink = 0;
+
+// `k_RESIDENT` is the steady state once the renderer keeps the arrays, the shim still hashes
+// every array to verify it but only the headers cross the ring
+template<bool k_BULK, bool k_RESIDENT = false>
+void record_draw_elements(glRemix::IPCProtocol& ipc, UINT64& commands)
+{
+    constexpr UINT32 k_DRAWS = 64;
+    constexpr UINT32 k_VERTICES = 4 * 1024;
+    constexpr UINT32 k_INDICES = 6 * 1024;
+
+    using namespace glRemix;
+
+    static const std::vector<float> positions(k_VERTICES * 3, 1.0f);
+    static const std::vector<float> colors(k_VERTICES * 4, 0.5f);
+    static const std::vector<float> normals(k_VERTICES * 3, 0.0f);
+    static const std::vector<UINT32> indices(k_INDICES, 7u);
+
+    constexpr auto k_RESIDENCY = k_RESIDENT ? GLRemixArrayResidency::RESIDENT
+                                            : GLRemixArrayResidency::SENT;
+    const GLRemixClientArrayHeader arrays[] = {
+        { GLRemixClientArrayType::VERTEX, 3, 0x1406, 12,
+          static_cast<UINT32>(positions.size() * sizeof(float)), k_RESIDENCY, {} },
+        { GLRemixClientArrayType::COLOR, 4, 0x1406, 16,
+          static_cast<UINT32>(colors.size() * sizeof(float)), k_RESIDENCY, {} },
+        { GLRemixClientArrayType::NORMAL, 3, 0x1406, 12,
+          static_cast<UINT32>(normals.size() * sizeof(float)), k_RESIDENCY, {} },
+        { GLRemixClientArrayType::INDICES, 1, 0x1405, 4,
+          static_cast<UINT32>(indices.size() * sizeof(UINT32)), k_RESIDENCY, {} },
+    };
+    const void* data[] = { positions.data(), colors.data(), normals.data(), indices.data() };
+
+    UINT32 extra_data_bytes = 0;
+    GLRemixDrawElementsCommand payload{ .mode = 0x0004,
+                                        .start = 0,
+                                        .end = k_VERTICES - 1,
+                                        .count = k_INDICES,
+                                        .type = 0x1405,
+                                        .enabled = static_cast<UINT32>(std::size(arrays)),
+                                        .client_data = {} };
+    for (const GLRemixClientArrayHeader& array : arrays)
+    {
+        extra_data_bytes += array.array_bytes;
+    }
+
+    for (UINT32 d = 0; d < k_DRAWS; d++)
+    {
+        if constexpr (k_RESIDENT)
+        {
+            for (UINT32 i = 0; i < std::size(arrays); i++)
+            {
+                g_hash_sink = g_hash_sink ^ hash_content(data[i], arrays[i].array_bytes);
+            }
+            ipc.write_command<GLCommandType::GLREMIXCMD_DRAW_ELEMENTS>(payload, sizeof(arrays));
+            ipc.write_simple(arrays, sizeof(arrays));
+            continue;
+        }
+
+        UINT8* bulk = k_BULK ? ipc.reserve_bulk(extra_data_bytes, &payload.client_data) : nullptr;
+        ipc.write_command<GLCommandType::GLREMIXCMD_DRAW_ELEMENTS>(
+            payload, sizeof(arrays) + (bulk ? 0 : extra_data_bytes));
+        ipc.write_simple(arrays, sizeof(arrays));
+        for (UINT32 i = 0; i < std::size(arrays); i++)
+        {
+            if (bulk)
+            {
+                memcpy(bulk, data[i], arrays[i].array_bytes);
+                bulk += arrays[i].array_bytes;
+                continue;
+            }
+            ipc.write_simple(data[i], arrays[i].array_bytes);
+        }
+    }
+    commands += k_DRAWS;
+}
+
+template<bool k_BULK>
+void record_tex_image(glRemix::IPCProtocol& ipc, UINT64& commands)
+{
+    constexpr UINT32 k_TEXTURES = 8;
+    constexpr UINT32 k_SIZE = 512;
+
+    using namespace glRemix;
+
+    static const std::vector<UINT8> pixels(k_SIZE * k_SIZE * 4, 0x7F);
+
+    GLTexImage2DCommand payload{ .target = 0x0DE1,
+                                       .level = 0,
+                                       .internalFormat = 0x1908,
+                                       .width = k_SIZE,
+                                       .height = k_SIZE,
+                                       .border = 0,
+                                       .format = 0x1908,
+                                       .type = 0x1401,
+                                       .pixels_hash = {},
+                                       .pixels = {} };
+    for (UINT32 t = 0; t < k_TEXTURES; t++)
+    {
+        const auto pixel_bytes = static_cast<UINT32>(pixels.size());
+        ipc.write_command<GLCommandType::GLCMD_BIND_TEXTURE>(GLBindTextureCommand{ 0x0DE1, t });
+        if (UINT8* bulk = k_BULK ? ipc.reserve_bulk(pixel_bytes, &payload.pixels) : nullptr)
+        {
+            ipc.write_command<GLCommandType::GLCMD_TEX_IMAGE_2D>(payload);
+            memcpy(bulk, pixels.data(), pixel_bytes);
+            continue;
+        }
+        ipc.write_command<GLCommandType::GLCMD_TEX_IMAGE_2D>(payload, pixel_bytes, true,
+                                                             pixels.data());
+    }
+    commands += 2 * k_TEXTURES;
+}
+
+// payload a record keeps in the bulk arena, counted so bulk mixes report comparable MB/s
+UINT32 s_bulk_bytes(const glRemix::GLCommandHeader* header)
+{
+    using namespace glRemix;
+    switch (header->get_type())
+    {
+        case GLCommandType::GLREMIXCMD_DRAW_ELEMENTS:
+        {
+            const auto* cmd = static_cast<const GLRemixDrawElementsCommand*>(header->get_payload());
+            return cmd->client_data.bytes;
+        }
+        case GLCommandType::GLCMD_TEX_IMAGE_2D:
+            return static_cast<const GLTexImage2DCommand*>(header->get_payload())->pixels.bytes;
+        default: return 0;
+    }
+}
+
+double percentile(std::vector<double>& sorted, const double p)
+{
+    const size_t i = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+    return sorted[i];
+}
+
+std::unique_ptr<glRemix::IPCTransport> make_transport(const std::string& name)
+{
+    return name == "platform" ? glRemix::create_platform_transport()
+                              : glRemix::create_loopback_transport();
+}
+
+// reads one byte per page, the way decode and uploads end up faulting payloads in
+UINT32 s_touch(const UINT8* data, const UINT32 bytes)
+{
+    UINT32 sum = 0;
+    for (UINT32 offset = 0; offset < bytes; offset += glRemix::k_IPC_PAGE_BYTES)
+    {
+        sum += data[offset];
+    }
+    return sum;
+}
+
+// a loading-screen sized frame: fills the ring, the bulk arena and an overflow segment
+void record_startup_frame(glRemix::IPCProtocol& ipc, UINT64& commands)
+{
+    for (UINT32 i = 0; i < 4; i++)
+    {
+        record_immediate(ipc, commands);
+    }
+    record_tex_image<true>(ipc, commands);
+    record_draw_elements<false>(ipc, commands);
+    record_tex_image<false>(ipc, commands);
+}
+
+void first_frame(const char* label, const glRemix::IPCMapOptions& options,
+                 const std::string& transport)
+{
+    constexpr UINT32 k_FRAMES = 2;
+
+    const auto start = Clock::now();
+
+    glRemix::IPCProtocol writer(make_transport(transport));
+    glRemix::IPCProtocol reader(make_transport(transport));
+    writer.set_map_options(options);
+    reader.set_map_options(options);
+    writer.init_writer();
+    reader.init_reader();
+
+    const auto ready = Clock::now();
+
+    std::thread writer_thread(
+        [&]
+        {
+            UINT64 commands = 0;
+            for (UINT32 f = 0; f < k_FRAMES; f++)
+            {
+                writer.start_frame_or_wait();
+                record_startup_frame(writer, commands);
+                writer.end_frame();
+            }
+        });
+
+    Clock::time_point frame_done[k_FRAMES];
+    UINT32 sink = 0;
+    for (UINT32 f = 0; f < k_FRAMES; f++)
+    {
+        bool frame_ended = false;
+        while (!frame_ended)
+        {
+            const glRemix::IPCCommandSpan span = reader.acquire_commands_or_wait(&frame_ended);
+            sink += s_touch(span.data, span.bytes);
+            for (UINT32 offset = 0; offset < span.bytes;)
+            {
+                const auto* header = reinterpret_cast<const glRemix::GLCommandHeader*>(span.data
+                                                                                       + offset);
+                if (header->get_type() == glRemix::GLCommandType::GLCMD_TEX_IMAGE_2D)
+                {
+                    const auto* cmd = static_cast<const glRemix::GLTexImage2DCommand*>(
+                        header->get_payload());
+                    if (cmd->pixels.bytes > 0)
+                    {
+                        sink += s_touch(reader.get_bulk_data(cmd->pixels), cmd->pixels.bytes);
+                    }
+                }
+                offset += align_u32(header->get_bytes() + header->get_cmd_bytes(),
+                                    glRemix::k_IPC_RECORD_ALIGNMENT);
+            }
+            reader.release_commands();
+        }
+        reader.release_bulk();
+        frame_done[f] = Clock::now();
+    }
+    writer_thread.join();
+
+    auto ms = [](const Clock::duration d)
+    { return std::chrono::duration<double, std::milli>(d).count(); };
+    std::printf("%-18s setup %8.2f ms   first frame %8.2f ms   second frame %8.2f ms  (sink %u)\n",
+                label, ms(ready - start), ms(frame_done[0] - ready),
+                ms(frame_done[1] - frame_done[0]), sink);
+}
+
+void run(const Mix& mix, const std::string& transport)
+{
+    glRemix::IPCProtocol writer(make_transport(transport));
+    glRemix::IPCProtocol reader(make_transport(transport));
+    writer.set_bulk_window(mix.bulk_window);
+    writer.init_writer();
+    reader.init_reader();
+
+    if (mix.publisher)
+    {
+        // the publisher begins every frame after this one
+        writer.start_frame_or_wait();
+        writer.start_publisher();
+    }
+
+    // written before `end_frame` publishes, read once the reader has seen that frame end
+    std::vector<Clock::time_point> frame_sent(mix.frames + 1);
+    UINT64 commands = 0;
+    Clock::duration game_time{};
+
+    const auto start = Clock::now();
+
+    std::thread writer_thread(
+        [&]
+        {
+            writer.set_writer_thread();
+            for (UINT32 f = 1; f <= mix.frames; f++)
+            {
+                writer.start_frame_or_wait();
+                const auto record_start = Clock::now();
+                mix.record(writer, commands);
+                frame_sent[f] = Clock::now();
+                writer.end_frame();
+                game_time += Clock::now() - record_start;
+            }
+        });
+
+    std::vector<double> latency_us;
+    latency_us.reserve(mix.frames);
+    UINT64 bytes = 0;
+    UINT64 ring_bytes = 0;
+    UINT32 sink = 0;
+
+    for (UINT32 f = 1; f <= mix.frames; f++)
+    {
+        bool frame_ended = false;
+        while (!frame_ended)
+        {
+            const glRemix::IPCCommandSpan span = reader.acquire_commands_or_wait(&frame_ended);
+
+            // walk the records like `glDriver::read_buffer`, touching only the headers
+            for (UINT32 offset = 0; offset < span.bytes;)
+            {
+                const auto* header = reinterpret_cast<const glRemix::GLCommandHeader*>(span.data
+                                                                                       + offset);
+                sink += static_cast<UINT32>(header->get_type());
+                bytes += s_bulk_bytes(header);
+                offset += align_u32(header->get_bytes() + header->get_cmd_bytes(),
+                                    glRemix::k_IPC_RECORD_ALIGNMENT);
+            }
+            bytes += span.bytes;
+            ring_bytes += span.bytes;
+
+            reader.release_commands();
+        }
+
+        const auto handoff = Clock::now() - frame_sent[reader.get_frame_index()];
+        latency_us.push_back(std::chrono::duration<double, std::micro>(handoff).count());
+
+        // the renderer frees bulk payloads once it has uploaded them, here right away
+        reader.release_bulk();
+    }
+
+    writer_thread.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const glRemix::IPCFrameStats stats = reader.get_frame_stats();
+
+    std::sort(latency_us.begin(), latency_us.end());
+    std::printf("%-28s %6u frames %10.1f MB/s %12.0f cmds/s   ring KB/frame %9.2f   "
+                "game us/frame %8.1f   "
+                "hand-off us p50 %8.1f  p99 %8.1f  "
+                "p999 %8.1f   writer blocked %.1f ms (%llu)   publisher blocked %.1f ms (%llu)   "
+                "spin/sleep writer %llu/%llu "
+                "reader %llu/%llu   remaps %llu  (sink %u)\n",
+                mix.name, mix.frames, bytes / seconds / 1e6, commands / seconds,
+                ring_bytes / 1024.0 / mix.frames,
+                std::chrono::duration<double, std::micro>(game_time).count() / mix.frames,
+                percentile(latency_us, 0.5), percentile(latency_us, 0.99),
+                percentile(latency_us, 0.999), stats.writer_blocked_ns / 1e6,
+                static_cast<unsigned long long>(stats.writer_blocked_count),
+                stats.publisher_blocked_ns / 1e6,
+                static_cast<unsigned long long>(stats.publisher_blocked_count),
+                static_cast<unsigned long long>(stats.writer_spin_hits),
+                static_cast<unsigned long long>(stats.writer_sleeps),
+                static_cast<unsigned long long>(stats.reader_spin_hits),
+                static_cast<unsigned long long>(stats.reader_sleeps),
+                static_cast<unsigned long long>(stats.bulk_view_remaps), sink);
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const UINT32 frames = argc > 1 ? static_cast<UINT32>(std::strtoul(argv[1], nullptr, 10)) : 0;
+    const std::string transport = argc > 2 ? argv[2] : "loopback";
+
+    const Mix mixes[] = {
+        { "gears", frames ? frames : 20000, record_gears },
+        { "immediate", frames ? frames : 2000, record_immediate },
+        { "immediate_reserve", frames ? frames : 2000, record_immediate_reserve },
+        { "vertex_batch", frames ? frames : 2000, record_vertex_batch },
+        { "draw_elements", frames ? frames : 500, record_draw_elements<false> },
+        { "draw_elements_bulk", frames ? frames : 500, record_draw_elements<true> },
+        { "draw_elements_resident", frames ? frames : 500, record_draw_elements<false, true> },
+        { "tex_image", frames ? frames : 500, record_tex_image<false> },
+        { "tex_image_bulk", frames ? frames : 500, record_tex_image<true> },
+        { "draw_elements_window", frames ? frames : 500, record_draw_elements<true>, 4 * MEGABYTE },
+        { "tex_image_window", frames ? frames : 500, record_tex_image<true>, 4 * MEGABYTE },
+        { "immediate_publisher", frames ? frames : 2000, record_immediate, 0, true },
+        { "draw_elements_publisher", frames ? frames : 500, record_draw_elements<false>, 0, true },
+        { "draw_elements_bulk_publisher", frames ? frames : 500, record_draw_elements<true>, 0,
+          true },
+        { "tex_image_bulk_publisher", frames ? frames : 500, record_tex_image<true>, 0, true },
+    };
+
+    std::printf("IPCProtocol over the %s transport\n", transport.c_str());
+    for (const Mix& mix : mixes)
+    {
+        run(mix, transport);
+    }
+
+    // loopback regions are zeroed heap blocks, so they always start out warm
+    std::printf("\nfirst frame after startup\n");
+    first_frame("cold", {}, transport);
+    first_frame("prefault", { .prefault = true }, transport);
+    first_frame("prefault+large", { .prefault = true, .large_pages = true }, transport);
+
+    return 0;
+}
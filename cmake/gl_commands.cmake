@@ -0,0 +1,36 @@
+include_guard(GLOBAL)
+
+if(NOT DEFINED REPO_ROOT)
+	message(FATAL_ERROR "Define REPO_ROOT before including gl_commands.cmake")
+endif()
+
+find_package(Python3 COMPONENTS Interpreter REQUIRED)
+
+set(GLREMIX_GL_COMMANDS_SCHEMA "${REPO_ROOT}/shared/gl_commands.schema")
+set(GLREMIX_GL_COMMANDS_SCRIPT "${REPO_ROOT}/glRemixShim/scripts/generate_gl_commands.py")
+
+# `GLCommandType`, the payload layouts and the renderer's dispatch are generated from the schema
+# into the target's binary dir, every target that includes `shared/gl_commands.h` needs them
+function(glremix_add_gl_commands target)
+	set(_dir "${CMAKE_CURRENT_BINARY_DIR}/generated")
+	set(_types "${_dir}/gl_command_types.inl")
+	set(_layouts "${_dir}/gl_command_layouts.inl")
+	set(_dispatch "${_dir}/gl_command_dispatch.inl")
+
+	add_custom_command(
+		OUTPUT "${_types}" "${_layouts}" "${_dispatch}"
+		COMMAND ${Python3_EXECUTABLE}
+			"${GLREMIX_GL_COMMANDS_SCRIPT}"
+			--schema "${GLREMIX_GL_COMMANDS_SCHEMA}"
+			--types-output "${_types}"
+			--layouts-output "${_layouts}"
+			--dispatch-output "${_dispatch}"
+		DEPENDS
+			"${GLREMIX_GL_COMMANDS_SCHEMA}"
+			"${GLREMIX_GL_COMMANDS_SCRIPT}"
+	)
+
+	target_sources(${target} PRIVATE "${_types}" "${_layouts}" "${_dispatch}")
+	set_source_files_properties("${_types}" "${_layouts}" "${_dispatch}" PROPERTIES HEADER_FILE_ONLY TRUE)
+	target_include_directories(${target} PRIVATE "${_dir}")
+endfunction()
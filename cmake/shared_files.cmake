@@ -13,8 +13,13 @@ set(containers "containers")
 set(GLREMIX_SHARED_HEADER_NAMES
 	"shared_memory.h"
 	"gl_commands.h"
+    "gl_commands.schema"
 	"ipc_protocol.h"
     "ipc_protocol.inl"
+    "ipc_ring.h"
+    "ipc_transport.h"
+    "platform.h"
+    "hash_utils.h"
     "gl_utils.h"
 	"math_utils.h"
 	"${containers}/free_list_vector.h"
@@ -23,6 +28,9 @@ set(GLREMIX_SHARED_HEADER_NAMES
 set(GLREMIX_SHARED_SOURCE_NAMES
     "shared_memory.cpp"
     "ipc_protocol.cpp"
+    "ipc_transport_win32.cpp"
+    "ipc_transport_posix.cpp"
+    "ipc_transport_loopback.cpp"
 )
 
 set(GLREMIX_SHARED_HEADER_FILES)
@@ -74,4 +74,27 @@ function(set_shim_compile_specifications target)
     if(GLREMIX_AUTO_LAUNCH_RENDERER)
         target_compile_definitions(${target} PRIVATE GLREMIX_AUTO_LAUNCH_RENDERER)
     endif()
+
+    if(GLREMIX_FRAME_POLICY)
+        target_compile_definitions(${target} PRIVATE
+            GLREMIX_FRAME_POLICY=${GLREMIX_FRAME_POLICY}
+            GLREMIX_FRAME_QUEUE_DEPTH=${GLREMIX_FRAME_QUEUE_DEPTH}
+        )
+    endif()
+
+    if(GLREMIX_IPC_PREFAULT)
+        target_compile_definitions(${target} PRIVATE GLREMIX_IPC_PREFAULT)
+    endif()
+
+    if(GLREMIX_IPC_LARGE_PAGES)
+        target_compile_definitions(${target} PRIVATE GLREMIX_IPC_LARGE_PAGES)
+    endif()
+
+    if(GLREMIX_IPC_PUBLISHER_THREAD)
+        target_compile_definitions(${target} PRIVATE GLREMIX_IPC_PUBLISHER_THREAD)
+    endif()
+
+    if(GLREMIX_IPC_BULK_WINDOW_MB)
+        target_compile_definitions(${target} PRIVATE GLREMIX_IPC_BULK_WINDOW_MB=${GLREMIX_IPC_BULK_WINDOW_MB})
+    endif()
 endfunction()
\ No newline at end of file
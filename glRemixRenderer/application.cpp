@@ -38,6 +38,8 @@ void Application::run_with_hwnd(const bool enable_debug_layer)
             }
         }
 
+        process_events();
+
         // TODO: Get quit signal from IPC and get it out of the app class?
         // Right now this process just gets killed externally
         render();
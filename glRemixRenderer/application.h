@@ -32,6 +32,9 @@ protected:
 
     virtual void render() {}
 
+    // called every loop iteration, independent of how often `render` gets a frame
+    virtual void process_events() {}
+
     virtual void destroy() {}
 
 public:
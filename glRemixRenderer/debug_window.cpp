@@ -1,6 +1,8 @@
 #include "debug_window.h"
 #include "imgui.h"
 
+#include <bit>
+
 using namespace glRemix;
 
 void DebugWindow::render()
@@ -46,6 +48,11 @@ void DebugWindow::set_mesh_buffer(std::vector<MeshRecord>& meshes)
     m_meshes = &meshes;
 }
 
+void DebugWindow::set_ipc_stats(const IPCFrameStats& stats)
+{
+    m_ipc_stats = stats;
+}
+
 // get replace_mesh function from rt_app
 void DebugWindow::set_replace_mesh_callback(
     std::function<void(uint64_t meshID, const char* asset_path)> callback)
@@ -102,6 +109,22 @@ void DebugWindow::render_performance_stats()
     m_fps = io.Framerate;
 
     ImGui::Text("FPS: %.1f (%.3f ms/frame)", m_fps, 1000.0f / m_fps);
+
+    ImGui::SeparatorText("IPC");
+    ImGui::Text("Frames in flight: %u", m_ipc_stats.frames_in_flight);
+    ImGui::Text("Frames dropped: %llu", m_ipc_stats.frames_dropped);
+    ImGui::Text("Game blocked: %.1f ms (%llu stalls)", m_ipc_stats.writer_blocked_ns / 1e6,
+                m_ipc_stats.writer_blocked_count);
+    ImGui::Text("Publisher blocked: %.1f ms (%llu stalls)", m_ipc_stats.publisher_blocked_ns / 1e6,
+                m_ipc_stats.publisher_blocked_count);
+    ImGui::Text("Spin hits / sleeps: game %llu / %llu, renderer %llu / %llu",
+                m_ipc_stats.writer_spin_hits, m_ipc_stats.writer_sleeps,
+                m_ipc_stats.reader_spin_hits, m_ipc_stats.reader_sleeps);
+    ImGui::Text("Bulk window remaps: %llu", m_ipc_stats.bulk_view_remaps);
+    ImGui::Text("Input events dropped: %u", m_ipc_stats.events_dropped);
+    ImGui::Text("Context streams: %d", 1 + std::popcount(m_ipc_stats.streams_open));
+    ImGui::Text("State calls elided: %u / frame (%.1f KB)", m_ipc_stats.commands_elided,
+                m_ipc_stats.bytes_elided / 1024.0);
     // TODO: More stats like heap allocations, allocate descriptors, memory usage, etc
 }
 
@@ -13,11 +13,14 @@
 #include "structs.h"
 #include "tsl/robin_map.h"
 
+#include <shared/ipc_protocol.h>
+
 namespace glRemix
 {
 class DebugWindow
 {
     float m_fps = 0.0f;
+    IPCFrameStats m_ipc_stats;
 
     const std::vector<MeshRecord>* m_meshes = nullptr;
     uint64_t m_meshID_to_replace = -1;
@@ -39,6 +42,7 @@ public:
     void render();
 
     void set_mesh_buffer(std::vector<MeshRecord>& meshes);
+    void set_ipc_stats(const IPCFrameStats& stats);
     void set_replace_mesh_callback(
         std::function<void(uint64_t meshID, const char* asset_path)> callback);
 };
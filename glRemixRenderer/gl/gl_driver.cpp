@@ -7,7 +7,7 @@ LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARA
 
 namespace glRemix
 {
-static void hash_and_commit_geometry(glState& state, const size_t* client_indices = nullptr)
+static void hash_and_commit_geometry(glState& state)
 {
     if (!state.m_perspective || state.t_indices.empty())
     {
@@ -55,12 +55,9 @@ static void hash_and_commit_geometry(glState& state, const size_t* client_indice
         XMStoreFloat3(&max_bb, maxv);
     }
 
-    bool use_existing = client_indices != nullptr;
     // get index data to hash
-    for (int i = 0; i < state.t_indices.size(); ++i)
+    for (const uint32_t index : state.t_indices)
     {
-        const uint32_t& index = use_existing ? client_indices[state.t_indices[i]]
-                                             : state.t_indices[i];
         hash_combine(index);
     }
 
@@ -123,8 +120,14 @@ static void hash_and_commit_geometry(glState& state, const size_t* client_indice
     state.m_meshes.push_back(*mesh);
 }
 
-static void triangulate(glState& state)
+// `elements` are the vertices in draw order (`glDrawElements`), by default all of them in order
+static void triangulate(glState& state, const UINT32* elements = nullptr, size_t element_count = 0)
 {
+    if (!elements)
+    {
+        element_count = state.t_vertices.size();
+    }
+
     switch (state.m_topology)
     {
         case GL_POINTS:
@@ -133,7 +136,7 @@ static void triangulate(glState& state)
         }
         case GL_LINES:
         {
-            const size_t vert_count = state.t_vertices.size();
+            const size_t vert_count = element_count;
             if (vert_count < 2)
             {
                 break;
@@ -155,7 +158,7 @@ static void triangulate(glState& state)
         }
         case GL_LINE_STRIP:
         {
-            const size_t vert_count = state.t_vertices.size();
+            const size_t vert_count = element_count;
             if (vert_count < 2)
             {
                 break;
@@ -178,7 +181,7 @@ static void triangulate(glState& state)
 
         case GL_LINE_LOOP:
         {
-            const size_t vert_count = state.t_vertices.size();
+            const size_t vert_count = element_count;
             if (vert_count < 2)
             {
                 break;
@@ -208,12 +211,10 @@ static void triangulate(glState& state)
 
         case GL_QUAD_STRIP:
         {
-            const size_t quad_count = state.t_vertices.size() >= 4
-                                          ? (state.t_vertices.size() - 2) / 2
-                                          : 0;
+            const size_t quad_count = element_count >= 4 ? (element_count - 2) / 2 : 0;
             state.t_indices.reserve(quad_count * 6);
 
-            for (uint32_t k = 0; k + 3 < state.t_vertices.size(); k += 2)
+            for (uint32_t k = 0; k + 3 < element_count; k += 2)
             {
                 uint32_t a = k + 0;
                 uint32_t b = k + 1;
@@ -232,10 +233,10 @@ static void triangulate(glState& state)
 
         case GL_QUADS:
         {
-            const size_t quad_count = state.t_vertices.size() / 4;
+            const size_t quad_count = element_count / 4;
             state.t_indices.reserve(quad_count * 6);
 
-            for (uint32_t k = 0; k + 3 < state.t_vertices.size(); k += 4)
+            for (uint32_t k = 0; k + 3 < element_count; k += 4)
             {
                 uint32_t a = k + 0;
                 uint32_t b = k + 1;
@@ -254,7 +255,7 @@ static void triangulate(glState& state)
 
         case GL_TRIANGLES:
         {
-            const size_t vert_count = state.t_vertices.size();
+            const size_t vert_count = element_count;
             if (vert_count < 3)
             {
                 break;
@@ -274,7 +275,7 @@ static void triangulate(glState& state)
 
         case GL_TRIANGLE_STRIP:
         {
-            const size_t vert_count = state.t_vertices.size();
+            const size_t vert_count = element_count;
             if (vert_count < 3)
             {
                 break;
@@ -309,7 +310,7 @@ static void triangulate(glState& state)
 
         case GL_TRIANGLE_FAN:
         {
-            const size_t vert_count = state.t_vertices.size();
+            const size_t vert_count = element_count;
             if (vert_count < 3)
             {
                 break;
@@ -334,7 +335,7 @@ static void triangulate(glState& state)
 
         case GL_POLYGON:
         {
-            const size_t vert_count = state.t_vertices.size();
+            const size_t vert_count = element_count;
             if (vert_count < 3)
             {
                 break;
@@ -359,21 +360,28 @@ static void triangulate(glState& state)
 
         default: break;
     }
+
+    // the cases above index into the element list, keep the vertices the elements point at
+    if (elements)
+    {
+        for (UINT32& index : state.t_indices)
+        {
+            index = elements[index];
+        }
+    }
 }
 
 // CORE IMMEDIATE MODE
-static void handle_begin(const GLCommandContext& ctx, const void* data)
+static void handle_begin(const GLCommandContext& ctx, const GLBeginCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLBeginCommand*>(data);
     ctx.state.m_topology = cmd->mode;
 
     ctx.state.t_vertices.clear();
     ctx.state.t_indices.clear();
 }
 
-static void handle_end(const GLCommandContext& ctx, const void* data)
+static void handle_end(const GLCommandContext& ctx, const GLEndCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLEndCommand*>(data);
     glState& state = ctx.state;
 
     triangulate(state);
@@ -381,10 +389,8 @@ static void handle_end(const GLCommandContext& ctx, const void* data)
     hash_and_commit_geometry(state);
 }
 
-static void handle_vertex2f(const GLCommandContext& ctx, const void* data)
+static void handle_vertex2f(const GLCommandContext& ctx, const GLVertex2fCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLVertex2fCommand*>(data);
-
     const Vertex vertex{ .position = fv_to_xmf3(GLVec3f{ cmd->x, cmd->y, 0.0f }),
                          .color = ctx.state.m_color,
                          .normal = ctx.state.m_normal,
@@ -392,10 +398,8 @@ static void handle_vertex2f(const GLCommandContext& ctx, const void* data)
     ctx.state.t_vertices.push_back(vertex);
 }
 
-static void handle_vertex3f(const GLCommandContext& ctx, const void* data)
+static void handle_vertex3f(const GLCommandContext& ctx, const GLVertex3fCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLVertex3fCommand*>(data);
-
     const Vertex vertex{ .position = fv_to_xmf3(*cmd),
                          .color = ctx.state.m_color,
                          .normal = ctx.state.m_normal,
@@ -403,38 +407,85 @@ static void handle_vertex3f(const GLCommandContext& ctx, const void* data)
     ctx.state.t_vertices.push_back(vertex);
 }
 
-static void handle_color3f(const GLCommandContext& ctx, const void* data)
+static void handle_color3f(const GLCommandContext& ctx, const GLColor3fCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLColor3fCommand*>(data);
-    ctx.state.m_color = { cmd->x, cmd->y, cmd->z, ctx.state.m_color.w };
+    ctx.state.m_color = { cmd->x, cmd->y, cmd->z, 1.0f };  // like GL, alpha is set to 1
 }
 
-static void handle_color4f(const GLCommandContext& ctx, const void* data)
+static void handle_color4f(const GLCommandContext& ctx, const GLColor4fCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLColor4fCommand*>(data);
     ctx.state.m_color = fv_to_xmf4(*cmd);
 }
 
-static void handle_normal3f(const GLCommandContext& ctx, const void* data)
+static void handle_normal3f(const GLCommandContext& ctx, const GLNormal3fCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLNormal3fCommand*>(data);
     ctx.state.m_normal = fv_to_xmf3(*cmd);
 }
 
-static void handle_texcoord2f(const GLCommandContext& ctx, const void* data)
+static void handle_texcoord2f(const GLCommandContext& ctx, const GLTexCoord2fCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLTexCoord2fCommand*>(data);
     ctx.state.m_uv = fv_to_xmf2(*cmd);
 }
 
+static void handle_vertex_batch(const GLCommandContext& ctx, const GLRemixVertexBatchCommand* cmd)
+{
+    glState& state = ctx.state;
+
+    state.m_topology = cmd->mode;
+    state.t_indices.clear();
+    state.t_vertices.resize(cmd->count);
+
+    // vertices before an attribute's first one in the batch use the value current at glBegin,
+    // attributes not set in the batch at all start past the last vertex
+    auto first = [cmd](const GLRemixVertexAttribute a)
+    {
+        const UINT32 i = static_cast<UINT32>(a);
+        return cmd->attributes & 1u << i ? cmd->first[i] : cmd->count;
+    };
+    const UINT32 color_first = first(GLRemixVertexAttribute::COLOR);
+    const UINT32 normal_first = first(GLRemixVertexAttribute::NORMAL);
+    const UINT32 uv_first = first(GLRemixVertexAttribute::TEXCOORD);
+
+    // arrays follow the positions in `GLRemixVertexAttribute` order, absent ones take no space
+    const auto* positions = reinterpret_cast<const GLVec3f*>(cmd + 1);
+    const auto* colors = reinterpret_cast<const GLVec4f*>(positions + cmd->count);
+    const auto* normals = reinterpret_cast<const GLVec3f*>(colors + (cmd->count - color_first));
+    const auto* uvs = reinterpret_cast<const GLVec2f*>(normals + (cmd->count - normal_first));
+
+    for (UINT32 v = 0; v < cmd->count; v++)
+    {
+        Vertex& vertex = state.t_vertices[v];
+        vertex.position = fv_to_xmf3(positions[v]);
+        vertex.color = v < color_first ? state.m_color : fv_to_xmf4(colors[v - color_first]);
+        vertex.normal = v < normal_first ? state.m_normal : fv_to_xmf3(normals[v - normal_first]);
+        vertex.uv = v < uv_first ? state.m_uv : fv_to_xmf2(uvs[v - uv_first]);
+    }
+
+    // the last values set in the batch stay current, like after the calls it replaces
+    if (cmd->attributes & 1u << static_cast<UINT32>(GLRemixVertexAttribute::COLOR))
+    {
+        state.m_color = fv_to_xmf4(cmd->color);
+    }
+    if (cmd->attributes & 1u << static_cast<UINT32>(GLRemixVertexAttribute::NORMAL))
+    {
+        state.m_normal = fv_to_xmf3(cmd->normal);
+    }
+    if (cmd->attributes & 1u << static_cast<UINT32>(GLRemixVertexAttribute::TEXCOORD))
+    {
+        state.m_uv = fv_to_xmf2(cmd->uv);
+    }
+
+    triangulate(state);
+
+    hash_and_commit_geometry(state);
+}
+
 // -----------------------------------------------------------------------------
 // MATERIAL COLOR
 // -----------------------------------------------------------------------------
 
-static void handle_call_list(const GLCommandContext& ctx, const void* data)
+static void handle_call_list(const GLCommandContext& ctx, const GLCallListCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLCallListCommand*>(data);
-
     if (ctx.state.m_display_lists.contains(cmd->list))
     {
         auto& list_buf = ctx.state.m_display_lists[cmd->list];
@@ -453,17 +504,17 @@ static void handle_call_list(const GLCommandContext& ctx, const void* data)
     }
 }
 
-static void handle_new_list(const GLCommandContext& ctx, const void* data)
+static void handle_new_list(const GLCommandContext& ctx, const GLNewListCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLNewListCommand*>(data);
-
     ctx.state.m_list_index = cmd->list;
     ctx.state.m_execution_mode = cmd->mode;
 
     ctx.state.m_display_list_begin = ctx.state.m_offset;
+    ctx.state.m_recording_list = true;
+    ctx.state.m_display_list_recording.clear();
 }
 
-static void handle_end_list(const GLCommandContext& ctx, const void* data)
+static void handle_end_list(const GLCommandContext& ctx, const GLEndListCommand* cmd)
 {
     if (ctx.state.m_in_call)
     {
@@ -471,15 +522,20 @@ static void handle_end_list(const GLCommandContext& ctx, const void* data)
         return;
     }
 
-    const auto* cmd = static_cast<const GLEndListCommand*>(data);
-
     const auto display_list_end = ctx.state
                                       .m_offset;  // record GL_END_LIST to mark end of display list
 
+    // the list may have started in an earlier span, append the rest before the lease is released
+    std::vector<UINT8>& new_list = ctx.state.m_display_list_recording;
+    new_list.insert(new_list.end(),
+                    ctx.driver.get_stream_data() + ctx.state.m_display_list_begin,
+                    ctx.driver.get_stream_data() + display_list_end);
+    ctx.driver.add_copied_bytes(display_list_end - ctx.state.m_display_list_begin);
+
     // record new list in respective index
-    std::vector new_list(ctx.driver.get_command_buffer_data() + ctx.state.m_display_list_begin,
-                         ctx.driver.get_command_buffer_data() + display_list_end);
     ctx.state.m_display_lists[ctx.state.m_list_index] = std::move(new_list);
+    ctx.state.m_display_list_recording.clear();
+    ctx.state.m_recording_list = false;
 
     ctx.state.m_execution_mode = GL_COMPILE_AND_EXECUTE;  // reset execution state
 }
@@ -488,59 +544,96 @@ static void handle_end_list(const GLCommandContext& ctx, const void* data)
 // TEXTURE
 // -----------------------------------------------------------------------------
 
-static void handle_bind_texture(const GLCommandContext& ctx, const void* data)
+static void handle_bind_texture(const GLCommandContext& ctx, const GLBindTextureCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLBindTextureCommand*>(data);
     ctx.state.m_texture_index = cmd->texture;
 }
 
-static void handle_delete_textures(const GLCommandContext& ctx, const void* data)
+static void handle_delete_textures(const GLCommandContext& ctx, const GLDeleteTexturesCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLDeleteTexturesCommand*>(data);
-
     UINT32 index = ctx.state.m_texture_indices[cmd->n];
 
     // TODO (delete textures)
 }
 
-static void handle_tex_image_2d(const GLCommandContext& ctx, const void* data)
+static UINT64 s_content_hash(const GLContentHash& hash)
 {
-    const auto* cmd = static_cast<const GLTexImage2DCommand*>(data);
+    return static_cast<UINT64>(hash.hi) << 32 | hash.lo;
+}
 
-    const auto* bytes = static_cast<const UINT8*>(data);
-    const void* data_ptr = bytes + sizeof(GLTexImage2DCommand);
+static void handle_tex_image_2d(const GLCommandContext& ctx, const GLTexImage2DCommand* cmd)
+{
+    glState& state = ctx.state;
+
+    // identical content was uploaded before, alias the existing texture instead of a new one
+    const UINT64 hash = s_content_hash(cmd->pixels_hash);
+    if (const auto it = state.m_texture_cache.find(hash); it != state.m_texture_cache.end())
+    {
+        state.m_texture_indices[state.m_texture_index] = it->second;
+        return;
+    }
+
+    const DXGI_FORMAT format = gl_format_to_dxgi(cmd->internalFormat, cmd->format, cmd->type);
+    if (format == DXGI_FORMAT_UNKNOWN)
+    {
+        // no texture is created, the shim stops reporting the name through `glIsTexture`
+        ctx.driver.report_error(GL_INVALID_ENUM);
+        ctx.driver.report_invalid_texture(state.m_texture_index);
+        return;
+    }
 
     PendingTexture tex;
     tex.desc = { cmd->width,
                  cmd->height,
                  1,  // depth of array size is always 1 (gl does not support non 2d)
                  1,
-                 gl_format_to_dxgi(cmd->internalFormat, cmd->format, cmd->type),
+                 format,
                  D3D12_RESOURCE_DIMENSION_TEXTURE2D,
                  false };
-    tex.pixels = data_ptr;
 
-    glState& state = ctx.state;
+    if (cmd->pixels.bytes > 0)
+    {
+        // the arena outlives the frame until the next `process_stream`, upload straight from it
+        tex.pixels = ctx.driver.get_bulk_data(cmd->pixels);
+    }
+    else
+    {
+        // pixels follow the command
+        const auto* pixels = reinterpret_cast<const UINT8*>(cmd + 1);
+        const UINT32 pixel_bytes = ctx.driver.get_command_bytes() - sizeof(GLTexImage2DCommand);
+
+        // uploads happen after the frame, once the ring space is long released
+        tex.pixel_data.assign(pixels, pixels + pixel_bytes);
+        tex.pixels = tex.pixel_data.data();
+        ctx.driver.add_copied_bytes(pixel_bytes);
+    }
+
     const UINT32 global_tex_index = state.m_num_textures
                                     + static_cast<UINT32>(state.m_pending_textures.size());
     state.m_texture_indices[state.m_texture_index] = global_tex_index;
 
     state.m_pending_textures.push_back(std::move(tex));
-}
 
-static void handle_tex_param(const GLCommandContext& ctx, const void* data)
-{
-    const auto* cmd = static_cast<const GLTexParameterCommand*>(data);
+    // textures are never destroyed, so the content stays available for hash-only uploads
+    if (hash != 0)
+    {
+        state.m_texture_cache.emplace(hash, global_tex_index);
+        ctx.driver.acknowledge_content(hash);
+    }
 }
 
-static void handle_tex_envi(const GLCommandContext& ctx, const void* data)
+static void handle_tex_image_2d_cached(const GLCommandContext& ctx, const GLTexImage2DCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLTexEnviCommand*>(data);
-}
+    glState& state = ctx.state;
 
-static void handle_tex_envf(const GLCommandContext& ctx, const void* data)
-{
-    const auto* cmd = static_cast<const GLTexEnvfCommand*>(data);
+    const auto it = state.m_texture_cache.find(s_content_hash(cmd->pixels_hash));
+    if (it == state.m_texture_cache.end())
+    {
+        // the shim only sends hashes this side acknowledged, so the cache can't miss
+        throw std::logic_error("glDriver - TEX_IMAGE_2D_CACHED references unknown content.");
+    }
+
+    state.m_texture_indices[state.m_texture_index] = it->second;
 }
 
 // -----------------------------------------------------------------------------
@@ -574,183 +667,349 @@ void convert_ptr(uint32_t type, size_t count, const void* ptr, O* out, bool norm
     }
 }
 
-static void handle_draw_arrays(const GLCommandContext& ctx, const void* data)
+// budget for arrays kept resident, beyond it the shim keeps sending new ones
+constexpr size_t k_MAX_RESIDENT_ARRAY_BYTES = 64 * 1024 * 1024;
+
+// retracted arrays stay findable, records written before the shim saw the retraction use them
+static const ResidentArray* s_find_resident_array(glState& state, const UINT64 hash)
+{
+    const auto it = state.m_resident_array_map.find(hash);
+    return it != state.m_resident_array_map.end() ? &*it->second : nullptr;
+}
+
+// marks the array as the most recently drawn, unless it is on its way out
+static void s_touch_resident_array(glState& state, const UINT64 hash)
+{
+    const auto it = state.m_resident_array_map.find(hash);
+    if (it != state.m_resident_array_map.end() && it->second->fence == GLStreamFence{})
+    {
+        state.m_resident_arrays.splice(state.m_resident_arrays.begin(), state.m_resident_arrays,
+                                       it->second);
+    }
+}
+
+// frees retracted arrays every stream has consumed past, once per frame
+static void s_release_retracted_arrays(const GLCommandContext& ctx)
 {
-    const GLRemixDrawArraysCommand* cmd = static_cast<const GLRemixDrawArraysCommand*>(data);
     glState& state = ctx.state;
+    for (auto it = state.m_retracted_arrays.begin(); it != state.m_retracted_arrays.end();)
+    {
+        if (!ctx.driver.has_consumed(it->fence))
+        {
+            ++it;
+            continue;
+        }
 
-    state.t_vertices.clear();
-    state.t_indices.clear();
+        state.m_resident_array_bytes -= it->bytes.size();
+        state.m_retracted_array_bytes -= it->bytes.size();
+        state.m_resident_array_map.erase(it->hash);
+        it = state.m_retracted_arrays.erase(it);
+    }
+}
 
-    state.m_topology = cmd->mode;
-    state.t_vertices.resize(cmd->count);
+// copies an array sent with `GLRemixArrayResidency::CACHE`, then lets the shim skip its bytes
+static void s_keep_resident_array(const GLCommandContext& ctx, const UINT64 hash,
+                                  const uint8_t* data, const UINT32 bytes)
+{
+    glState& state = ctx.state;
+    if (hash == 0 || bytes > k_MAX_RESIDENT_ARRAY_BYTES)
+    {
+        return;
+    }
 
-    const uint8_t* client_data = reinterpret_cast<const uint8_t*>(cmd + 1);
+    if (const auto it = state.m_resident_array_map.find(hash);
+        it != state.m_resident_array_map.end())
+    {
+        // the shim resends arrays it saw retracted, such an array is simply kept again
+        if (it->second->fence != GLStreamFence{})
+        {
+            it->second->fence = {};
+            state.m_retracted_array_bytes -= it->second->bytes.size();
+            state.m_resident_arrays.splice(state.m_resident_arrays.begin(),
+                                           state.m_retracted_arrays, it->second);
+            ctx.driver.acknowledge_content(hash);
+        }
+        // else a draw sent before the shim saw the ack
+        return;
+    }
 
-    thread_local std::vector<float> scratch_buffer;
+    // retract the least recently drawn until the live arrays leave room
+    while (state.m_resident_array_bytes - state.m_retracted_array_bytes + bytes
+               > k_MAX_RESIDENT_ARRAY_BYTES
+           && !state.m_resident_arrays.empty())
+    {
+        const auto oldest = std::prev(state.m_resident_arrays.end());
+        oldest->fence = ctx.driver.retract_content(oldest->hash);
+        state.m_retracted_array_bytes += oldest->bytes.size();
+        state.m_retracted_arrays.splice(state.m_retracted_arrays.end(), state.m_resident_arrays,
+                                        oldest);
+    }
 
-    // Loop over enabled arrays
-    for (uint32_t arr = 0; arr < cmd->enabled; arr++)
+    // retracted arrays still hold their bytes, this one keeps crossing the ring until they go
+    if (state.m_resident_array_bytes + bytes > k_MAX_RESIDENT_ARRAY_BYTES)
     {
-        const GLRemixClientArrayHeader& h = cmd->headers[arr];
+        return;
+    }
 
-        const size_t component_count = cmd->count * h.size;
-        const bool normalize = h.array_type == GLRemixClientArrayType::COLOR;
+    state.m_resident_arrays.push_front({ hash, { data, data + bytes } });
+    state.m_resident_array_map.emplace(hash, state.m_resident_arrays.begin());
+    state.m_resident_array_bytes += bytes;
 
-        scratch_buffer.resize(component_count);
-        float* f_ptr = scratch_buffer.data();
+    ctx.driver.add_copied_bytes(bytes);
+    ctx.driver.acknowledge_content(hash);
+}
 
-        for (size_t v_idx = 0; v_idx < cmd->count; v_idx++)
+/*
+ * Bytes of one array from vertex `first` on, `client_data` moves past those sent with the draw.
+ * nullptr when the shim referenced an array this side doesn't hold, the draw is then skipped.
+ */
+static const uint8_t* s_client_array_bytes(const GLCommandContext& ctx,
+                                           const GLRemixClientArrayHeader& h, const UINT32 first,
+                                           const uint8_t*& client_data)
+{
+    if (h.residency == GLRemixArrayResidency::LOCKED)
+    {
+        if (h.array_type >= GLRemixClientArrayType::_COUNT)
         {
-            const void* src = client_data + (v_idx * h.stride);
+            return nullptr;
+        }
 
-            convert_ptr<float>(h.type, h.size, src, f_ptr, normalize);
+        const auto& locked = ctx.state.m_locked_arrays[static_cast<size_t>(h.array_type)];
+        const size_t offset = static_cast<size_t>(first - ctx.state.m_locked_first) * h.stride;
+        if (first < ctx.state.m_locked_first || offset + h.array_bytes > locked.size())
+        {
+            return nullptr;
+        }
+        ctx.driver.add_resident_bytes(h.array_bytes);
+        return locked.data() + offset;
+    }
 
-            switch (h.array_type)
-            {
-                case GLRemixClientArrayType::VERTEX:
-                    state.t_vertices[v_idx].position = XMFLOAT3{ f_ptr[0], f_ptr[1],
-                                                                 h.size > 2 ? f_ptr[2] : 0.0f };
-                    break;
+    const UINT64 hash = s_content_hash(h.content_hash);
+    if (h.residency == GLRemixArrayResidency::RESIDENT)
+    {
+        const ResidentArray* array = s_find_resident_array(ctx.state, hash);
+        if (!array || array->bytes.size() != h.array_bytes)
+        {
+            return nullptr;
+        }
+        s_touch_resident_array(ctx.state, hash);
+        ctx.driver.add_resident_bytes(h.array_bytes);
+        return array->bytes.data();
+    }
 
-                case GLRemixClientArrayType::NORMAL:
-                    state.t_vertices[v_idx].normal = XMFLOAT3{ f_ptr[0], f_ptr[1], f_ptr[2] };
-                    break;
+    const uint8_t* data = client_data;
+    client_data += h.array_bytes;
+    if (h.residency == GLRemixArrayResidency::CACHE)
+    {
+        s_keep_resident_array(ctx, hash, data, h.array_bytes);
+    }
+    return data;
+}
 
-                case GLRemixClientArrayType::COLOR:
-                    state.t_vertices[v_idx].color = XMFLOAT4{ f_ptr[0], f_ptr[1], f_ptr[2],
-                                                              h.size > 3 ? f_ptr[3] : 1.0f };
-                    break;
+// fills one attribute of every vertex in `state.t_vertices` from a client array
+static void s_read_client_array(glState& state, const GLRemixClientArrayHeader& h,
+                                const uint8_t* client_data)
+{
+    thread_local std::vector<float> scratch_buffer;
 
-                case GLRemixClientArrayType::TEXCOORD:
-                    state.t_vertices[v_idx].uv = XMFLOAT2{ f_ptr[0], h.size > 1 ? f_ptr[1] : 0.0f };
-                    break;
+    const size_t vertex_count = state.t_vertices.size();
+    const bool normalize = h.array_type == GLRemixClientArrayType::COLOR;
 
-                default: break;
-            }
+    scratch_buffer.resize(vertex_count * h.size);
+    float* f_ptr = scratch_buffer.data();
+
+    for (size_t v_idx = 0; v_idx < vertex_count; v_idx++)
+    {
+        const void* src = client_data + (v_idx * h.stride);
+
+        convert_ptr<float>(h.type, h.size, src, f_ptr, normalize);
+
+        switch (h.array_type)
+        {
+            case GLRemixClientArrayType::VERTEX:
+                state.t_vertices[v_idx].position = XMFLOAT3{ f_ptr[0], f_ptr[1],
+                                                             h.size > 2 ? f_ptr[2] : 0.0f };
+                break;
+
+            case GLRemixClientArrayType::NORMAL:
+                state.t_vertices[v_idx].normal = XMFLOAT3{ f_ptr[0], f_ptr[1], f_ptr[2] };
+                break;
 
-            f_ptr += h.size;
+            case GLRemixClientArrayType::COLOR:
+                state.t_vertices[v_idx].color = XMFLOAT4{ f_ptr[0], f_ptr[1], f_ptr[2],
+                                                          h.size > 3 ? f_ptr[3] : 1.0f };
+                break;
+
+            case GLRemixClientArrayType::TEXCOORD:
+                state.t_vertices[v_idx].uv = XMFLOAT2{ f_ptr[0], h.size > 1 ? f_ptr[1] : 0.0f };
+                break;
+
+            default: break;
         }
-        client_data += h.array_bytes;
+
+        f_ptr += h.size;
+    }
+}
+
+static void handle_draw_arrays(const GLCommandContext& ctx, const GLRemixDrawArraysCommand* cmd)
+{
+    glState& state = ctx.state;
+
+    state.t_vertices.clear();
+    state.t_indices.clear();
+
+    state.m_topology = cmd->mode;
+    state.t_vertices.resize(cmd->count);
+
+    // only the enabled arrays' headers are sent, back to back after the command
+    const auto* headers = reinterpret_cast<const GLRemixClientArrayHeader*>(cmd + 1);
+    const uint8_t* client_data = cmd->client_data.bytes > 0
+                                     ? ctx.driver.get_bulk_data(cmd->client_data)
+                                     : reinterpret_cast<const uint8_t*>(headers + cmd->enabled);
+
+    // Loop over enabled arrays
+    for (uint32_t arr = 0; arr < cmd->enabled; arr++)
+    {
+        const uint8_t* data = s_client_array_bytes(ctx, headers[arr], cmd->first, client_data);
+        if (!data)
+        {
+            state.t_vertices.clear();
+            return;
+        }
+        s_read_client_array(state, headers[arr], data);
     }
     triangulate(state);
 
     hash_and_commit_geometry(state);
 }
 
-static void handle_draw_elements(const GLCommandContext& ctx, const void* data)
+// `glDrawRangeElements` too, both send vertices [start, end] and the indices into them
+template<typename GLDrawElementsCommand>
+static void handle_draw_elements(const GLCommandContext& ctx, const GLDrawElementsCommand* cmd)
 {
-    const GLRemixDrawElementsCommand* cmd = static_cast<const GLRemixDrawElementsCommand*>(data);
     glState& state = ctx.state;
 
     state.t_vertices.clear();
     state.t_indices.clear();
 
+    const UINT32 vertex_count = cmd->end - cmd->start + 1;
     state.m_topology = cmd->mode;
-    state.t_vertices.resize(cmd->count);
+    state.t_vertices.resize(vertex_count);
 
-    const uint8_t* client_data = reinterpret_cast<const uint8_t*>(cmd + 1);
+    // only the enabled arrays' headers are sent, back to back after the command
+    const auto* headers = reinterpret_cast<const GLRemixClientArrayHeader*>(cmd + 1);
+    const uint8_t* client_data = cmd->client_data.bytes > 0
+                                     ? ctx.driver.get_bulk_data(cmd->client_data)
+                                     : reinterpret_cast<const uint8_t*>(headers + cmd->enabled);
 
-    thread_local std::vector<float> scratch_buffer;
-    thread_local std::vector<size_t> client_indices;
+    thread_local std::vector<UINT32> elements;
+    elements.clear();
 
     // Loop over enabled arrays
     for (uint32_t arr = 0; arr < cmd->enabled; arr++)
     {
-        const GLRemixClientArrayHeader& h = cmd->headers[arr];
+        const GLRemixClientArrayHeader& h = headers[arr];
+        const uint8_t* data = s_client_array_bytes(ctx, h, cmd->start, client_data);
+        if (!data)
+        {
+            state.t_vertices.clear();
+            return;
+        }
 
         if (h.array_type == GLRemixClientArrayType::INDICES)
         {
-            client_indices.resize(cmd->count);
-            convert_ptr<size_t>(h.type, cmd->count, client_data, client_indices.data());
-            client_data += h.array_bytes;
-            continue;
+            elements.resize(cmd->count);
+            convert_ptr<UINT32>(h.type, cmd->count, data, elements.data());
         }
-
-        const size_t component_count = cmd->count * h.size;
-        const bool normalize = h.array_type == GLRemixClientArrayType::COLOR;
-
-        scratch_buffer.resize(component_count);
-        float* f_ptr = scratch_buffer.data();
-
-        for (size_t v_idx = 0; v_idx < cmd->count; v_idx++)
+        else
         {
-            const void* src = client_data + (v_idx * h.stride);
+            s_read_client_array(state, h, data);
+        }
+    }
 
-            convert_ptr<float>(h.type, h.size, src, f_ptr, normalize);
+    // rebase on `start`, indices outside the range `glDrawRangeElements` promised drop the draw
+    for (UINT32& element : elements)
+    {
+        element -= cmd->start;
+        if (element >= vertex_count)
+        {
+            state.t_vertices.clear();
+            return;
+        }
+    }
 
-            switch (h.array_type)
-            {
-                case GLRemixClientArrayType::VERTEX:
-                    state.t_vertices[v_idx].position = XMFLOAT3{ f_ptr[0], f_ptr[1],
-                                                                 h.size > 2 ? f_ptr[2] : 0.0f };
-                    break;
+    // the vertices stay shared, the mesh and its BLAS are built indexed
+    triangulate(state, elements.data(), elements.size());
 
-                case GLRemixClientArrayType::NORMAL:
-                    state.t_vertices[v_idx].normal = XMFLOAT3{ f_ptr[0], f_ptr[1], f_ptr[2] };
-                    break;
+    hash_and_commit_geometry(state);
+}
 
-                case GLRemixClientArrayType::COLOR:
-                    state.t_vertices[v_idx].color = XMFLOAT4{ f_ptr[0], f_ptr[1], f_ptr[2],
-                                                              h.size > 3 ? f_ptr[3] : 1.0f };
-                    break;
+// keeps the locked arrays until the next lock, draws of the lock read them as `LOCKED` arrays
+static void handle_lock_arrays(const GLCommandContext& ctx, const GLRemixLockArraysCommand* cmd)
+{
+    glState& state = ctx.state;
 
-                case GLRemixClientArrayType::TEXCOORD:
-                    state.t_vertices[v_idx].uv = XMFLOAT2{ f_ptr[0], h.size > 1 ? f_ptr[1] : 0.0f };
-                    break;
+    for (std::vector<UINT8>& locked : state.m_locked_arrays)
+    {
+        locked.clear();
+    }
+    state.m_locked_first = cmd->first;
 
-                default: break;
-            }
+    const auto* headers = reinterpret_cast<const GLRemixClientArrayHeader*>(cmd + 1);
+    const uint8_t* client_data = cmd->client_data.bytes > 0
+                                     ? ctx.driver.get_bulk_data(cmd->client_data)
+                                     : reinterpret_cast<const uint8_t*>(headers + cmd->enabled);
 
-            f_ptr += h.size;
+    // the ring span is released long before the lock ends, so the arrays are copied out
+    for (uint32_t arr = 0; arr < cmd->enabled; arr++)
+    {
+        const GLRemixClientArrayHeader& h = headers[arr];
+        const uint8_t* data = s_client_array_bytes(ctx, h, cmd->first, client_data);
+        if (data && h.array_type < GLRemixClientArrayType::_COUNT)
+        {
+            state.m_locked_arrays[static_cast<size_t>(h.array_type)].assign(data,
+                                                                            data + h.array_bytes);
+            ctx.driver.add_copied_bytes(h.array_bytes);
         }
-        client_data += h.array_bytes;
     }
-
-    triangulate(state);
-
-    hash_and_commit_geometry(state, client_indices.data());
 }
 
 // MATRIX OPERATIONS
-static void handle_matrix_mode(const GLCommandContext& ctx, const void* data)
+static void handle_matrix_mode(const GLCommandContext& ctx, const GLMatrixModeCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLMatrixModeCommand*>(data);
-
     ctx.state.m_matrix_mode = cmd->mode;
 }
 
-static void handle_load_identity(const GLCommandContext& ctx, const void* data)
+static void handle_load_identity(const GLCommandContext& ctx, const GLLoadIdentityCommand* cmd)
 {
     ctx.state.m_matrix_stack.identity(ctx.state.m_matrix_mode);
 }
 
-static void handle_load_matrix(const GLCommandContext& ctx, const void* data)
+static void handle_load_matrix(const GLCommandContext& ctx, const GLLoadMatrixCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLLoadMatrixCommand*>(data);
     ctx.state.m_matrix_stack.load(ctx.state.m_matrix_mode, cmd->m);
 }
 
-static void handle_mult_matrix(const GLCommandContext& ctx, const void* data)
+static void handle_mult_matrix(const GLCommandContext& ctx, const GLMultMatrixCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLMultMatrixCommand*>(data);
     ctx.state.m_matrix_stack.mul_set(ctx.state.m_matrix_mode, cmd->m);
 }
 
-static void handle_push_matrix(const GLCommandContext& ctx, const void* data)
+static void handle_push_matrix(const GLCommandContext& ctx, const GLPushMatrixCommand* cmd)
 {
     ctx.state.m_matrix_stack.push(ctx.state.m_matrix_mode);
 }
 
-static void handle_pop_matrix(const GLCommandContext& ctx, const void* data)
+static void handle_pop_matrix(const GLCommandContext& ctx, const GLPopMatrixCommand* cmd)
 {
-    ctx.state.m_matrix_stack.pop(ctx.state.m_matrix_mode);
+    if (!ctx.state.m_matrix_stack.pop(ctx.state.m_matrix_mode))
+    {
+        ctx.driver.report_error(GL_STACK_UNDERFLOW);
+    }
 }
 
-static void handle_translate(const GLCommandContext& ctx, const void* data)
+static void handle_translate(const GLCommandContext& ctx, const GLTranslateCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLTranslateCommand*>(data);
-
     const float x = cmd->t.x;
     const float y = cmd->t.y;
     const float z = cmd->t.z;
@@ -758,10 +1017,8 @@ static void handle_translate(const GLCommandContext& ctx, const void* data)
     ctx.state.m_matrix_stack.translate(ctx.state.m_matrix_mode, x, y, z);
 }
 
-static void handle_rotate(const GLCommandContext& ctx, const void* data)
+static void handle_rotate(const GLCommandContext& ctx, const GLRotateCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLRotateCommand*>(data);
-
     const float angle = cmd->angle;
     const float x = cmd->axis.x;
     const float y = cmd->axis.y;
@@ -770,10 +1027,8 @@ static void handle_rotate(const GLCommandContext& ctx, const void* data)
     ctx.state.m_matrix_stack.rotate(ctx.state.m_matrix_mode, angle, x, y, z);
 }
 
-static void handle_scale(const GLCommandContext& ctx, const void* data)
+static void handle_scale(const GLCommandContext& ctx, const GLScaleCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLScaleCommand*>(data);
-
     const float x = cmd->s.x;
     const float y = cmd->s.y;
     const float z = cmd->s.z;
@@ -781,46 +1036,41 @@ static void handle_scale(const GLCommandContext& ctx, const void* data)
     ctx.state.m_matrix_stack.scale(ctx.state.m_matrix_mode, x, y, z);
 }
 
-static void handle_ortho(const GLCommandContext& ctx, const void* data)
+static void handle_viewport(const GLCommandContext& ctx, const GLViewportCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLOrthoCommand*>(data);
+    ctx.state.m_viewport = { cmd->x, cmd->y, cmd->width, cmd->height };
+}
 
+static void handle_ortho(const GLCommandContext& ctx, const GLOrthoCommand* cmd)
+{
     ctx.state.m_matrix_stack.ortho(ctx.state.m_matrix_mode, cmd->left, cmd->right, cmd->bottom,
                                    cmd->top, cmd->zNear, cmd->zFar);
     ctx.state.m_perspective = false;
 }
 
-static void handle_frustum(const GLCommandContext& ctx, const void* data)
+static void handle_frustum(const GLCommandContext& ctx, const GLFrustumCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLFrustumCommand*>(data);
-
     ctx.state.m_matrix_stack.frustum(ctx.state.m_matrix_mode, cmd->left, cmd->right, cmd->bottom,
                                      cmd->top, cmd->zNear, cmd->zFar);
     ctx.state.m_perspective = true;
 }
 
-static void handle_perspective(const GLCommandContext& ctx, const void* data)
+static void handle_perspective(const GLCommandContext& ctx, const GLPerspectiveCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLPerspectiveCommand*>(data);
-
     ctx.state.m_matrix_stack.perspective(ctx.state.m_matrix_mode, cmd->fovY, cmd->aspect,
                                          cmd->zNear, cmd->zFar);
     ctx.state.m_perspective = true;
 }
 
 // RENDERING
-static void handle_clear_color(const GLCommandContext& ctx, const void* data)
+static void handle_clear_color(const GLCommandContext& ctx, const GLClearColorCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLClearColorCommand*>(data);
-
     ctx.state.m_clear_color = fv_to_xmf4(cmd->color);
 }
 
 // FIXED FUNCTION
-static void handle_lightf(const GLCommandContext& ctx, const void* data)
+static void handle_lightf(const GLCommandContext& ctx, const GLLightCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLLightCommand*>(data);
-
     uint32_t light_index = cmd->light - GL_LIGHT0;
     Light& m_light = ctx.state.m_lights[light_index];
 
@@ -835,10 +1085,8 @@ static void handle_lightf(const GLCommandContext& ctx, const void* data)
     }
 }
 
-static void handle_lightfv(const GLCommandContext& ctx, const void* data)
+static void handle_lightfv(const GLCommandContext& ctx, const GLLightfvCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLLightfvCommand*>(data);
-
     uint32_t light_index = cmd->light - GL_LIGHT0;
     Light& m_light = ctx.state.m_lights[light_index];
 
@@ -856,10 +1104,8 @@ static void handle_lightfv(const GLCommandContext& ctx, const void* data)
     }
 }
 
-static void handle_materiali(const GLCommandContext& ctx, const void* data)
+static void handle_materiali(const GLCommandContext& ctx, const GLMaterialiCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLMaterialiCommand*>(data);
-
     float param = static_cast<float>(cmd->param);
 
     switch (cmd->pname)
@@ -878,10 +1124,8 @@ static void handle_materiali(const GLCommandContext& ctx, const void* data)
     }
 }
 
-static void handle_materialf(const GLCommandContext& ctx, const void* data)
+static void handle_materialf(const GLCommandContext& ctx, const GLMaterialfCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLMaterialfCommand*>(data);
-
     switch (cmd->pname)
     {
         case GL_AMBIENT: ctx.state.m_material.ambient = f_to_xmf4(cmd->param); break;
@@ -898,10 +1142,8 @@ static void handle_materialf(const GLCommandContext& ctx, const void* data)
     }
 }
 
-static void handle_materialfv(const GLCommandContext& ctx, const void* data)
+static void handle_materialfv(const GLCommandContext& ctx, const GLMaterialfvCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLMaterialfvCommand*>(data);
-
     switch (cmd->pname)
     {
         case GL_AMBIENT: ctx.state.m_material.ambient = fv_to_xmf4(cmd->params); break;
@@ -950,112 +1192,43 @@ static void set_state(const GLCommandContext& ctx, unsigned int cap, bool value)
     }
 }
 
-static void handle_enable(const GLCommandContext& ctx, const void* data)
+static void handle_enable(const GLCommandContext& ctx, const GLEnableCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLEnableCommand*>(data);
     set_state(ctx, cmd->cap, true);
 }
 
-static void handle_disable(const GLCommandContext& ctx, const void* data)
+static void handle_disable(const GLCommandContext& ctx, const GLDisableCommand* cmd)
 {
-    const auto* cmd = static_cast<const GLDisableCommand*>(data);
     set_state(ctx, cmd->cap, false);
 }
 
 // OTHER
-static void handle_wgl_create_context(const GLCommandContext& ctx, const void* data)
+static void handle_wgl_create_context(const GLCommandContext& ctx,
+                                      const WGLCreateContextCommand* cmd)
 {
-    const auto cmd = static_cast<const WGLCreateContextCommand*>(data);
-    ctx.state.hwnd = cmd->hwnd;
-    ctx.state.m_create_context = true;
+    // streams outlive contexts, a new one starts over from GL's initial state
+    static_cast<glContextState&>(ctx.state) = glContextState{};
+
+    if (ctx.driver.get_decode_stream() == 0)
+    {
+        ctx.state.hwnd = reinterpret_cast<HWND>(static_cast<UINT_PTR>(cmd->hwnd));
+        ctx.state.m_create_context = true;
+    }
 }
 
-static void handle_wgl_input_event(const GLCommandContext& ctx, const void* data)
+// payload sizes come from gl_commands.schema, IPC markers never reach the decoder
+static bool s_matches_layout(const GLCommandLayout& layout, const UINT32 cmd_bytes)
 {
-    const auto* cmd = static_cast<const WGLInputEventCommand*>(data);
-    if (ctx.state.hwnd)
+    switch (layout.kind)
     {
-        ImGui_ImplWin32_WndProcHandler(ctx.state.hwnd, cmd->msg, cmd->wparam,
-                                       static_cast<LPARAM>(cmd->lparam));
+        case GLPayloadLayout::FIXED: return cmd_bytes == layout.payload_bytes;
+        case GLPayloadLayout::TRAILING: return cmd_bytes >= layout.payload_bytes;
+        default: return false;
     }
 }
-}  // namespace glRemix
 
-void glRemix::glDriver::init_handlers()
-{
-    using enum GLCommandType;
-
-    gl_command_handlers.fill(nullptr);
-
-    // CORE IMMEDIATE MODE
-    gl_command_handlers[static_cast<size_t>(GLCMD_BEGIN)] = &handle_begin;
-    gl_command_handlers[static_cast<size_t>(GLCMD_END)] = &handle_end;
-    gl_command_handlers[static_cast<size_t>(GLCMD_VERTEX2F)] = &handle_vertex2f;
-    gl_command_handlers[static_cast<size_t>(GLCMD_VERTEX3F)] = &handle_vertex3f;
-    gl_command_handlers[static_cast<size_t>(GLCMD_COLOR3F)] = &handle_color3f;
-    gl_command_handlers[static_cast<size_t>(GLCMD_COLOR4F)] = &handle_color4f;
-    gl_command_handlers[static_cast<size_t>(GLCMD_NORMAL3F)] = &handle_normal3f;
-    gl_command_handlers[static_cast<size_t>(GLCMD_TEXCOORD2F)] = &handle_texcoord2f;
-
-    // MATERIALS LIGHTS
-    gl_command_handlers[static_cast<size_t>(GLCMD_LIGHTF)] = &handle_lightf;
-    gl_command_handlers[static_cast<size_t>(GLCMD_LIGHTFV)] = &handle_lightfv;
-    gl_command_handlers[static_cast<size_t>(GLCMD_MATERIALI)] = &handle_materiali;
-    gl_command_handlers[static_cast<size_t>(GLCMD_MATERIALF)] = &handle_materialf;
-    gl_command_handlers[static_cast<size_t>(GLCMD_MATERIALIV)] = &handle_materialfv;
-    gl_command_handlers[static_cast<size_t>(GLCMD_MATERIALFV)] = &handle_materialfv;
-    gl_command_handlers[static_cast<size_t>(GLCMD_CLEAR_COLOR)] = &handle_clear_color;
-
-    // TEXTURES
-    gl_command_handlers[static_cast<size_t>(GLCMD_BIND_TEXTURE)] = &handle_bind_texture;
-    gl_command_handlers[static_cast<size_t>(GLCMD_DELETE_TEXTURES)] = &handle_delete_textures;
-    gl_command_handlers[static_cast<size_t>(GLCMD_TEX_IMAGE_2D)] = &handle_tex_image_2d;
-    gl_command_handlers[static_cast<size_t>(GLCMD_TEX_PARAMETER)] = &handle_tex_param;
-    gl_command_handlers[static_cast<size_t>(GLCMD_TEX_ENV_I)] = &handle_tex_envi;
-    gl_command_handlers[static_cast<size_t>(GLCMD_TEX_ENV_F)] = &handle_tex_envf;
-    // CLIENT STATE
-    gl_command_handlers[static_cast<size_t>(GLREMIXCMD_DRAW_ARRAYS)] = &handle_draw_arrays;
-    gl_command_handlers[static_cast<size_t>(GLREMIXCMD_DRAW_ELEMENTS)] = &handle_draw_elements;
-    gl_command_handlers[static_cast<size_t>(GLREMIXCMD_DRAW_RANGE_ELEMENTS)] = &handle_draw_elements;
-
-    // MATRIX OPERATIONS
-    gl_command_handlers[static_cast<size_t>(GLCMD_MATRIX_MODE)] = &handle_matrix_mode;
-    gl_command_handlers[static_cast<size_t>(GLCMD_LOAD_IDENTITY)] = &handle_load_identity;
-    gl_command_handlers[static_cast<size_t>(GLCMD_LOAD_MATRIX)] = &handle_load_matrix;
-    gl_command_handlers[static_cast<size_t>(GLCMD_MULT_MATRIX)] = &handle_mult_matrix;
-    gl_command_handlers[static_cast<size_t>(GLCMD_PUSH_MATRIX)] = &handle_push_matrix;
-    gl_command_handlers[static_cast<size_t>(GLCMD_POP_MATRIX)] = &handle_pop_matrix;
-    gl_command_handlers[static_cast<size_t>(GLCMD_TRANSLATE)] = &handle_translate;
-    gl_command_handlers[static_cast<size_t>(GLCMD_ROTATE)] = &handle_rotate;
-    gl_command_handlers[static_cast<size_t>(GLCMD_SCALE)] = &handle_scale;
-    gl_command_handlers[static_cast<size_t>(GLCMD_ORTHO)] = &handle_ortho;
-    gl_command_handlers[static_cast<size_t>(GLCMD_FRUSTUM)] = &handle_frustum;
-    gl_command_handlers[static_cast<size_t>(GLCMD_PERSPECTIVE)] = &handle_perspective;
-
-    // RENDERING
-    gl_command_handlers[static_cast<size_t>(GLCMD_CLEAR_COLOR)] = &handle_clear_color;
-
-    // FIXED FUNCTION
-    gl_command_handlers[static_cast<size_t>(GLCMD_LIGHTF)] = &handle_lightf;
-    gl_command_handlers[static_cast<size_t>(GLCMD_LIGHTFV)] = &handle_lightfv;
-    gl_command_handlers[static_cast<size_t>(GLCMD_MATERIALI)] = &handle_materiali;
-    gl_command_handlers[static_cast<size_t>(GLCMD_MATERIALF)] = &handle_materialf;
-    gl_command_handlers[static_cast<size_t>(GLCMD_MATERIALIV)] = &handle_materialfv;
-    gl_command_handlers[static_cast<size_t>(GLCMD_MATERIALFV)] = &handle_materialfv;
-
-    // STATE MANAGEMENT
-    gl_command_handlers[static_cast<size_t>(GLCMD_ENABLE)] = &handle_enable;
-    gl_command_handlers[static_cast<size_t>(GLCMD_DISABLE)] = &handle_disable;
-
-    // DISPLAY LISTS
-    gl_command_handlers[static_cast<size_t>(GLCMD_NEW_LIST)] = &handle_new_list;
-    gl_command_handlers[static_cast<size_t>(GLCMD_CALL_LIST)] = &handle_call_list;
-    gl_command_handlers[static_cast<size_t>(GLCMD_END_LIST)] = &handle_end_list;
-
-    // OTHER
-    gl_command_handlers[static_cast<size_t>(WGLCMD_CREATE_CONTEXT)] = &handle_wgl_create_context;
-    gl_command_handlers[static_cast<size_t>(WGLCMD_INPUT_EVENT)] = &handle_wgl_input_event;
-}
+#include "gl_command_dispatch.inl"
+}  // namespace glRemix
 
 glRemix::glDriver::glDriver()
 {
@@ -1064,23 +1237,24 @@ glRemix::glDriver::glDriver()
 
 void glRemix::glDriver::init()
 {
-    m_ipc.init_reader();
+    init_stream_reader(m_ipc);
+}
 
-    init_handlers();
+void glRemix::glDriver::init_stream_reader(IPCProtocol& ipc)
+{
+#ifdef GLREMIX_IPC_PREFAULT
+    ipc.set_map_options({ .prefault = true });
+#endif
+    ipc.init_reader();
+
+    // the shim assumes conservative limits until it hears the real ones
+    ipc.push_reply({ IPCReplyType::INTEGER, GL_MAX_TEXTURE_SIZE,
+                     D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION });
 }
 
 void glRemix::glDriver::process_stream()
 {
-    uint32_t frame_index = 0;
-    uint32_t frame_bytes = 0;
-    m_ipc.consume_frame_or_wait(m_command_buffer.data(), &frame_index, &frame_bytes);
-
-    if (frame_bytes == 0)
-    {
-        return;
-    }
-
-    m_state.m_current_frame = frame_index;
+    GLCommandContext ctx{ m_state, *this };
 
     // reset per frames
     m_state.m_create_context = false;
@@ -1090,9 +1264,217 @@ void glRemix::glDriver::process_stream()
     m_state.m_pending_geometries.clear();  // clear pending geometry data
     m_state.m_pending_textures.clear();
 
+    // the previous frames' pending uploads are done, their bulk payloads can be reused
+    s_release_retracted_arrays(ctx);
+    m_ipc.release_bulk();
+    for (const std::unique_ptr<GLStream>& stream : m_streams)
+    {
+        if (stream)
+        {
+            stream->ipc.release_bulk();
+        }
+    }
+
+    // other contexts may have created objects this frame is about to use
+    m_ipc.take_signaled_streams();
+    consume_streams(ctx);
+
+    // mailbox mode: frames a newer one has replaced are decoded but never presented
+    consume_frame(ctx);
+    while (m_ipc.drop_stale_frame())
+    {
+        drop_frame();
+        consume_frame(ctx);
+    }
+}
+
+glRemix::GLStreamFence glRemix::glDriver::retract_content(const UINT64 hash)
+{
+    m_decode_ipc->retract_content(hash);
+
+    // streams opened later only ever see the retraction
+    GLStreamFence fence{};
+    fence[0] = m_ipc.get_retraction_fence();
+    for (UINT32 stream = 1; stream < k_IPC_MAX_STREAMS; stream++)
+    {
+        if (m_streams[stream])
+        {
+            fence[stream] = m_streams[stream]->ipc.get_retraction_fence();
+        }
+    }
+    return fence;
+}
+
+bool glRemix::glDriver::has_consumed(const GLStreamFence& fence) const
+{
+    if (!m_ipc.has_consumed(fence[0]))
+    {
+        return false;
+    }
+    for (UINT32 stream = 1; stream < k_IPC_MAX_STREAMS; stream++)
+    {
+        if (m_streams[stream] && fence[stream] != 0
+            && !m_streams[stream]->ipc.has_consumed(fence[stream]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void glRemix::glDriver::consume_frame(const GLCommandContext& ctx)
+{
+    // decode in place while the shim is still recording, until the frame end marker shows up
+    bool frame_ended = false;
+    while (!frame_ended)
+    {
+        const IPCCommandSpan span = m_ipc.acquire_commands_or_wait(&frame_ended);
+        m_state.m_current_frame = m_ipc.get_frame_index();
+
+        decode_span(ctx, span);
+        m_ipc.release_commands();
+
+        // the ring wakes us for input too, so a slow frame doesn't hold it back
+        process_events();
+
+        // and for other contexts, which may be what the game waits on before it can finish
+        if (m_ipc.take_signaled_streams() != 0)
+        {
+            consume_streams(ctx);
+        }
+    }
+}
+
+void glRemix::glDriver::decode_span(const GLCommandContext& ctx, const IPCCommandSpan& span)
+{
+    m_stream_data = span.data;
     m_state.m_offset = 0;
-    GLCommandContext ctx{ m_state, *this };
-    read_buffer(ctx, m_command_buffer.data(), frame_bytes, m_state.m_offset);
+    read_buffer(ctx, span.data, span.bytes, m_state.m_offset);
+
+    // list continues in a later span, keep what was recorded so far
+    if (m_state.m_recording_list)
+    {
+        m_state.m_display_list_recording.insert(m_state.m_display_list_recording.end(),
+                                                span.data + m_state.m_display_list_begin,
+                                                span.data + span.bytes);
+        m_decode_stats.bytes_copied += span.bytes - m_state.m_display_list_begin;
+        m_state.m_display_list_begin = 0;
+    }
+
+    m_decode_stats.bytes_leased += span.bytes;
+    m_stream_data = nullptr;
+}
+
+void glRemix::glDriver::open_streams()
+{
+    const UINT32 open = m_ipc.get_open_streams();
+    for (UINT32 stream = 1; stream < k_IPC_MAX_STREAMS; stream++)
+    {
+        if (m_streams[stream] || !(open & 1u << stream))
+        {
+            continue;
+        }
+
+        // the shim lists a stream only once its ring is initialized, so this doesn't wait
+        auto opened = std::make_unique<GLStream>();
+        opened->ipc.set_stream(stream);
+        init_stream_reader(opened->ipc);
+        m_streams[stream] = std::move(opened);
+    }
+}
+
+void glRemix::glDriver::consume_streams(const GLCommandContext& ctx)
+{
+    open_streams();
+    for (UINT32 stream = 1; stream < k_IPC_MAX_STREAMS; stream++)
+    {
+        if (m_streams[stream] && m_streams[stream]->ipc.has_commands())
+        {
+            consume_stream(ctx, stream);
+        }
+    }
+}
+
+void glRemix::glDriver::consume_stream(const GLCommandContext& ctx, const UINT32 stream)
+{
+    GLStream& other = *m_streams[stream];
+    const size_t meshes = m_state.m_meshes.size();
+    const size_t pending = m_state.m_pending_geometries.size();
+
+    // the other context's state goes in, stream 0's waits in its place
+    std::swap(static_cast<glContextState&>(m_state), other.context);
+    switch_share_group(m_ipc.get_share_group(stream));
+    m_decode_ipc = &other.ipc;
+    m_decode_stream = stream;
+
+    // everything published, whole frames or not, it never blocks stream 0
+    while (other.ipc.has_commands())
+    {
+        bool frame_ended = false;
+        const IPCCommandSpan span = other.ipc.acquire_commands_or_wait(&frame_ended);
+        decode_span(ctx, span);
+        other.ipc.release_commands();
+    }
+
+    m_decode_ipc = &m_ipc;
+    m_decode_stream = 0;
+    switch_share_group(m_ipc.get_share_group(0));
+    std::swap(static_cast<glContextState&>(m_state), other.context);
+
+    // only stream 0's window is presented, other contexts just leave their resources behind
+    m_state.m_meshes.erase(m_state.m_meshes.begin() + meshes, m_state.m_meshes.end());
+    for (size_t i = pending; i < m_state.m_pending_geometries.size(); i++)
+    {
+        m_state.m_pending_geometries[i].presented = false;
+    }
+}
+
+void glRemix::glDriver::switch_share_group(const UINT32 group)
+{
+    if (group == m_state_group)
+    {
+        return;
+    }
+
+    m_share_groups[m_state_group] = std::move(static_cast<glShareGroupState&>(m_state));
+
+    auto& state_group = static_cast<glShareGroupState&>(m_state);
+    if (auto it = m_share_groups.find(group); it != m_share_groups.end())
+    {
+        state_group = std::move(it.value());
+        m_share_groups.erase(it);
+    }
+    else
+    {
+        state_group = glShareGroupState{};
+    }
+    m_state_group = group;
+}
+
+void glRemix::glDriver::process_events()
+{
+    IPCEvent event;
+    while (m_ipc.pop_event(&event))
+    {
+        // nothing to feed before the game created its context, ImGui needs the window
+        if (m_state.hwnd)
+        {
+            ImGui_ImplWin32_WndProcHandler(m_state.hwnd, event.msg,
+                                           static_cast<WPARAM>(event.wparam),
+                                           static_cast<LPARAM>(event.lparam));
+        }
+    }
+}
+
+void glRemix::glDriver::drop_frame()
+{
+    // draws go, resources the frame created stay. materials and matrices are kept as well since
+    // pending geometry refers to them by index
+    m_state.m_meshes.clear();
+    for (PendingGeometry& pending : m_state.m_pending_geometries)
+    {
+        pending.presented = false;
+    }
 }
 
 void glRemix::glDriver::read_buffer(const GLCommandContext& ctx, const uint8_t* buffer,
@@ -1110,21 +1492,8 @@ void glRemix::glDriver::read_buffer(const GLCommandContext& ctx, const uint8_t*
             }
         }
 
-        const auto idx = static_cast<size_t>(view.type);
-
-        GLCommandHandler handler = gl_command_handlers[idx];
-
-        if (handler)
-        {
-            handler(ctx, view.data);
-        }
-        else
-        {
-            char buffer[256];
-            sprintf_s(buffer, "glxRemixRenderer - Unhandled Command: %d (size: %u)\n", view.type,
-                      view.cmd_bytes);
-            OutputDebugStringA(buffer);
-        }
+        m_command_bytes = view.cmd_bytes;
+        dispatch_command(ctx, view.type, view.data);
     }
 }
 
@@ -1138,18 +1507,35 @@ bool glRemix::glDriver::read_next_command(const uint8_t* buffer, size_t buffer_s
     }
 
     const auto* header = reinterpret_cast<const GLCommandHeader*>(buffer + offset);
-    offset += sizeof(GLCommandHeader);
+    if (header->is_long() && offset + 2 * sizeof(UINT32) > buffer_size)
+    {
+        return false;
+    }
+
+    // `k_GLCMD_WIRE_VERSION` records only use the long form for payloads that need it
+    const UINT32 cmd_bytes = header->get_cmd_bytes();
+    if (header->get_type() >= GLCommandType::_COUNT
+        || (header->is_long() && cmd_bytes < k_GLCMD_LONG_BYTES)
+        || !s_matches_layout(get_command_layout(header->get_type()), cmd_bytes))
+    {
+        throw std::runtime_error(FSTR("glDriver - Malformed command record {} at offset {}",
+                                      header->packed, offset));
+    }
+
+    // records are padded so the next header stays aligned
+    const size_t record_bytes = align_u32(header->get_bytes() + cmd_bytes,
+                                          k_IPC_RECORD_ALIGNMENT);
 
     // ensure that we are not reading out of bounds
-    if (offset + header->cmd_bytes > buffer_size)
+    if (offset + record_bytes > buffer_size)
     {
         return false;
     }
 
-    out.type = header->type;
-    out.cmd_bytes = header->cmd_bytes;
-    out.data = buffer + offset;
+    out.type = header->get_type();
+    out.cmd_bytes = cmd_bytes;
+    out.data = header->get_payload();
 
-    offset += header->cmd_bytes;  // move header after extracting latest command
+    offset += record_bytes;  // move header after extracting latest command
     return true;
 }
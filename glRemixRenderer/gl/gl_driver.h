@@ -7,10 +7,10 @@
 
 #include <vector>
 #include <array>
+#include <memory>
 
 namespace glRemix
 {
-constexpr size_t NUM_COMMANDS = static_cast<size_t>(GLCommandType::_COUNT);
 constexpr SIZE_T NUM_CLIENT_ARRAYS = static_cast<SIZE_T>(GLRemixClientArrayType::_COUNT);
 
 class glDriver;  // forward declare
@@ -24,6 +24,15 @@ struct GLCommandView
     const void* data;
 };
 
+// bytes decoded in place from the IPC ring vs. bytes copied out of it
+struct GLDecodeStats
+{
+    UINT64 bytes_leased = 0;
+    UINT64 bytes_copied = 0;    // display lists, texture pixels and arrays kept resident
+    UINT64 bytes_bulk = 0;      // payloads read in place from the bulk arena
+    UINT64 bytes_resident = 0;  // client arrays the shim didn't resend
+};
+
 // passed in to static handlers to allow them to affect persistent gl state
 struct GLCommandContext
 {
@@ -31,22 +40,48 @@ struct GLCommandContext
     glDriver& driver;  // required for recursive calls like call lists
 };
 
+// stream of a GL context other than stream 0's, decoded in between stream 0's spans
+struct GLStream
+{
+    IPCProtocol ipc;
+    glContextState context;  // swapped into `glState` while the stream is decoded
+};
+
 class glDriver
 {
     glState m_state;
-    IPCProtocol m_ipc;
-    std::array<UINT8, k_MAX_IPC_PAYLOAD> m_command_buffer;
+    IPCProtocol m_ipc;                     // stream 0, the context whose frames are presented
+    const UINT8* m_stream_data = nullptr;  // span currently leased from the ring
+    UINT32 m_command_bytes = 0;            // payload of the command being handled
+    GLDecodeStats m_decode_stats;
+
+    // other contexts' streams, [0] stays empty
+    std::array<std::unique_ptr<GLStream>, k_IPC_MAX_STREAMS> m_streams;
+
+    // namespaces of every share group but the one in `m_state`
+    tsl::robin_map<UINT32, glShareGroupState> m_share_groups;
+    UINT32 m_state_group = 0;
 
-    using GLCommandHandler = void (*)(const GLCommandContext&, const void* data);
-    std::array<GLCommandHandler, NUM_COMMANDS> gl_command_handlers{};
+    IPCProtocol* m_decode_ipc = &m_ipc;  // stream currently decoded
+    UINT32 m_decode_stream = 0;
 
     void init();
-    void init_handlers();
+    void init_stream_reader(IPCProtocol& ipc);
+    void consume_frame(const GLCommandContext& ctx);
+    void decode_span(const GLCommandContext& ctx, const IPCCommandSpan& span);
+    void open_streams();
+    void consume_streams(const GLCommandContext& ctx);
+    void consume_stream(const GLCommandContext& ctx, UINT32 stream);
+    void switch_share_group(UINT32 group);
+    void drop_frame();
     bool read_next_command(const UINT8* buffer, size_t buffer_size, size_t& offset,
                            GLCommandView& out);
 
 public:
     void process_stream();
+
+    // forwards out-of-band window messages to ImGui, cheap when none are pending
+    void process_events();
     void read_buffer(const GLCommandContext& ctx, const UINT8* buffer, size_t buffer_size,
                      size_t& offset);
 
@@ -55,9 +90,73 @@ public:
         return m_state;
     }
 
-    const UINT8* get_command_buffer_data() const
+    // only valid while the current span is decoded, see `IPCProtocol::acquire_commands_or_wait`
+    const UINT8* get_stream_data() const
+    {
+        return m_stream_data;
+    }
+
+    // payload bytes of the command whose handler is running, trailing data included
+    UINT32 get_command_bytes() const
+    {
+        return m_command_bytes;
+    }
+
+    // 0 while stream 0 is decoded, the only one owning the presented window
+    UINT32 get_decode_stream() const
+    {
+        return m_decode_stream;
+    }
+
+    IPCFrameStats get_frame_stats() const
+    {
+        return m_ipc.get_frame_stats();
+    }
+
+    const GLDecodeStats& get_decode_stats() const
+    {
+        return m_decode_stats;
+    }
+
+    // stays valid until the next `process_stream`, see `IPCProtocol::release_bulk`
+    const UINT8* get_bulk_data(const GLBulkHandle& handle)
+    {
+        m_decode_stats.bytes_bulk += handle.bytes;
+        return m_decode_ipc->get_bulk_data(handle);
+    }
+
+    void acknowledge_content(const UINT64 hash)
+    {
+        m_decode_ipc->acknowledge_content(hash);
+    }
+
+    /*
+     * Before dropping content the shim may reference by hash. The content ack table is shared,
+     * so every stream may have records in flight that use it, the content has to stay until
+     * `has_consumed` the returned fence.
+     */
+    GLStreamFence retract_content(UINT64 hash);
+    bool has_consumed(const GLStreamFence& fence) const;
+
+    // corrections for the shim's mirrored state, see `IPCProtocol::push_reply`
+    void report_error(const UINT32 error)
+    {
+        m_decode_ipc->push_reply({ IPCReplyType::GL_ERROR, 0, static_cast<INT32>(error) });
+    }
+
+    void report_invalid_texture(const UINT32 texture)
+    {
+        m_decode_ipc->push_reply({ IPCReplyType::TEXTURE_INVALID, texture, 0 });
+    }
+
+    void add_copied_bytes(const size_t bytes)
+    {
+        m_decode_stats.bytes_copied += bytes;
+    }
+
+    void add_resident_bytes(const size_t bytes)
     {
-        return m_command_buffer.data();
+        m_decode_stats.bytes_resident += bytes;
     }
 
     glDriver();
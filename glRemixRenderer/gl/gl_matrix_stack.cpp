@@ -70,33 +70,24 @@ void glMatrixStack::push(const UINT32 mode)
     }
 }
 
-void glMatrixStack::pop(const UINT32 mode)
+bool glMatrixStack::pop(const UINT32 mode)
 {
+    std::stack<XMFLOAT4X4>* stack;
     switch (mode)
     {
-        case GL_MODELVIEW:
-            if (model_view.size() > 1)
-            {
-                model_view.pop();
-            }
-            break;
-
-        case GL_PROJECTION:
-            if (projection.size() > 1)
-            {
-                projection.pop();
-            }
-            break;
-
-        case GL_TEXTURE:
-            if (texture.size() > 1)
-            {
-                texture.pop();
-            }
-            break;
+        case GL_MODELVIEW: stack = &model_view; break;
+        case GL_PROJECTION: stack = &projection; break;
+        case GL_TEXTURE: stack = &texture; break;
+        default: return true;
+    }
 
-        default: break;
+    if (stack->size() <= 1)
+    {
+        return false;
     }
+
+    stack->pop();
+    return true;
 }
 
 XMFLOAT4X4& glMatrixStack::top(const UINT32 mode)
@@ -22,7 +22,7 @@ public:
     std::stack<XMFLOAT4X4> texture;
 
     void push(UINT32 mode);
-    void pop(UINT32 mode);
+    bool pop(UINT32 mode);  // false if only the bottom matrix is left (stack underflow)
     XMFLOAT4X4& top(UINT32 mode);
     void mul_set(UINT32 mode, const XMMATRIX& r);  // multiplies and sets top of stack
     void mul_set(UINT32 mode, const float* m);     // multiplies and sets top of stack
@@ -1,22 +1,30 @@
 #pragma once
 
 #include "structs.h"
+#include <shared/gl_commands.h>
+#include <shared/ipc_ring.h>
 #include <tsl/robin_map.h>
 #include "gl/gl_matrix_stack.h"
 #include <array>
+#include <list>
 #include <vector>
 
 namespace glRemix
 {
-class glState
-{
-public:
-    UINT32 m_current_frame;
-    size_t m_offset;  // tracked by state for display list purposes
+// frame count per stream after which content retracted now is no longer referenced, 0 if closed
+using GLStreamFence = std::array<UINT32, k_IPC_MAX_STREAMS>;
 
-    HWND hwnd;
-    bool m_create_context;
+// copy of a client array the shim sends by content hash alone
+struct ResidentArray
+{
+    UINT64 hash;
+    std::vector<UINT8> bytes;
+    GLStreamFence fence{};  // set once retracted, records in flight may still reference it
+};
 
+// state a GL context owns, swapped into `glState` while that context's stream is decoded
+struct glContextState
+{
     XMFLOAT4 m_color = { 1.0f, 1.0f, 1.0f, 1.0f };
     XMFLOAT3 m_normal = { 0.0f, 0.0f, 1.0f };  // Default according to spec
     XMFLOAT2 m_uv = { 0.0f, 0.0f };
@@ -28,13 +36,8 @@ public:
     UINT32 m_execution_mode = GL_COMPILE_AND_EXECUTE;
     UINT32 m_list_index = 0;
     size_t m_display_list_begin = 0;
-    void* m_buffer_begin;
-
-    tsl::robin_map<int, std::vector<UINT8>> m_display_lists;
-
-    // cached structs
-    std::vector<Material> m_materials;
-    std::vector<XMFLOAT4X4> m_matrix_pool;
+    bool m_recording_list = false;
+    std::vector<UINT8> m_display_list_recording;  // list contents copied out of earlier spans
 
     // lighting
     std::array<Light, 8> m_lights{};
@@ -45,23 +48,68 @@ public:
     gl::glMatrixStack m_matrix_stack;
     UINT32 m_matrix_mode = GL_MODELVIEW;
     bool m_perspective = true;
+    std::array<INT32, 4> m_viewport{};  // x, y, width, height, empty until `glViewport`
 
     // geometry
     UINT32 m_topology = GL_QUADS;
     std::vector<Vertex> t_vertices;
     std::vector<UINT32> t_indices;
+
+    // arrays of the last `glLockArraysEXT`, by `GLRemixClientArrayType`, empty if not locked
+    UINT32 m_locked_first = 0;
+    std::array<std::vector<UINT8>, static_cast<size_t>(GLRemixClientArrayType::_COUNT)>
+        m_locked_arrays;
+
+    // textures
+    bool m_texture_2d;
+    UINT32 m_texture_index = 0;
+};
+
+// object names every context of a share group sees, see `wglShareLists`
+struct glShareGroupState
+{
+    tsl::robin_map<int, std::vector<UINT8>> m_display_lists;
+    tsl::robin_map<UINT32, UINT32> m_texture_indices;
+};
+
+/*
+ * Holds the context and share group of the stream being decoded, stream 0's in between.
+ * Everything else is shared by all streams and read by the renderer after `process_stream`.
+ */
+class glState : public glContextState, public glShareGroupState
+{
+public:
+    UINT32 m_current_frame;
+    size_t m_offset;  // tracked by state for display list purposes
+
+    HWND hwnd;
+    bool m_create_context;
+
+    void* m_buffer_begin;
+
+    // cached structs
+    std::vector<Material> m_materials;
+    std::vector<XMFLOAT4X4> m_matrix_pool;
+
+    // geometry
     std::vector<MeshRecord> m_meshes;
 
     tsl::robin_map<UINT64, MeshRecord> m_mesh_map;
     UINT32 m_num_mesh_resources;
     std::vector<PendingGeometry> m_pending_geometries;
 
+    // client arrays kept for hash-only draws, most recently drawn first. Evicted ones wait in
+    // `m_retracted_arrays` until no record in flight can reference them, the map holds both
+    std::list<ResidentArray> m_resident_arrays;
+    std::list<ResidentArray> m_retracted_arrays;
+    tsl::robin_map<UINT64, std::list<ResidentArray>::iterator> m_resident_array_map;
+    size_t m_resident_array_bytes = 0;  // held, retracted ones included
+    size_t m_retracted_array_bytes = 0;
+
     // textures
-    bool m_texture_2d;
     UINT32 m_num_textures;
-    tsl::robin_map<UINT32, UINT32> m_texture_indices;
+    tsl::robin_map<UINT64, UINT32> m_texture_cache;  // pixel content hash -> global texture index
     std::vector<PendingTexture> m_pending_textures;
-    UINT32 m_texture_index = 0;
     tsl::robin_map<UINT32, MeshRecord>
         m_mesh_replacement_tracker;  // maps index in m_meshes of mesh to be replaced, with
                                      // replacement mesh
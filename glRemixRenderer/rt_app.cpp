@@ -448,7 +448,7 @@ void glRemix::glRemixRenderer::create_pending_buffers(ID3D12GraphicsCommandList7
             // add mesh to m_mesh_replacement_tracker
             state.m_mesh_replacement_tracker.emplace(pending.replace_idx, *mesh);
         }
-        else
+        else if (pending.presented)
         {
             state.m_meshes.push_back(*mesh);
         }
@@ -1095,6 +1095,7 @@ void glRemix::glRemixRenderer::render()
 
     // render imgui
     m_debug_window.set_mesh_buffer(state.m_meshes);
+    m_debug_window.set_ipc_stats(sm_driver.get_frame_stats());
     m_debug_window.render();
 
     // Build all pending buffers from geometry collected in read_gl_command_stream
@@ -1416,6 +1417,11 @@ void glRemix::glRemixRenderer::render()
     m_fence_frame_ready_val[get_frame_index()] = current_fence_value + 1;
 }
 
+void glRemix::glRemixRenderer::process_events()
+{
+    sm_driver.process_events();
+}
+
 void glRemix::glRemixRenderer::destroy()
 {
     m_context.destroy_imgui();
@@ -105,6 +105,7 @@ class glRemixRenderer : public Application
 protected:
     void create() override;
     void render() override;
+    void process_events() override;
     void destroy() override;
 
 private:
@@ -57,13 +57,15 @@ struct PendingGeometry
     UINT32 mat_idx;
     UINT32 mv_idx;
     UINT32 replace_idx = -1;
+    bool presented = true;  // false if created by a frame dropped in mailbox mode
 };
 
 struct PendingTexture
 {
     UINT32 index;
     dx::TextureDesc desc;
-    const void* pixels;
+    const void* pixels;             // bulk arena or `pixel_data`
+    std::vector<UINT8> pixel_data;  // owned copy of inline pixels, the IPC record is released
 };
 
 }  // namespace glRemix
@@ -10,12 +10,20 @@ set(GLREMIX_SHIM_SOURCE_FILES
     "${GLREMIX_SHIM_SOURCE_DIR}/gl_exports.cpp"
     "${GLREMIX_SHIM_SOURCE_DIR}/gl_loader.cpp"
     "${GLREMIX_SHIM_SOURCE_DIR}/gl_hooks.cpp"
+    "${GLREMIX_SHIM_SOURCE_DIR}/gl_context.cpp"
+    "${GLREMIX_SHIM_SOURCE_DIR}/gl_state_mirror.cpp"
+    "${GLREMIX_SHIM_SOURCE_DIR}/gl_state_filter.cpp"
+    "${GLREMIX_SHIM_SOURCE_DIR}/gl_vertex_batch.cpp"
     "${GLREMIX_SHIM_SOURCE_DIR}/wgl_exports.cpp"
 )
 
 set(GLREMIX_SHIM_HEADER_FILES
     "${GLREMIX_SHIM_SOURCE_DIR}/framework.h"
     "${GLREMIX_SHIM_SOURCE_DIR}/gl_hooks.h"
+    "${GLREMIX_SHIM_SOURCE_DIR}/gl_context.h"
+    "${GLREMIX_SHIM_SOURCE_DIR}/gl_state_mirror.h"
+    "${GLREMIX_SHIM_SOURCE_DIR}/gl_state_filter.h"
+    "${GLREMIX_SHIM_SOURCE_DIR}/gl_vertex_batch.h"
     "${GLREMIX_SHIM_SOURCE_DIR}/gl_loader.h"
     "${GLREMIX_SHIM_SOURCE_DIR}/wgl_export_aliases.inl"
     "${GLREMIX_SHIM_SOURCE_DIR}/export_macros.h"
@@ -26,6 +34,7 @@ set(GLREMIX_SHIM_HEADER_FILES
 set(GLREMIX_SHIM_SCRIPT_FILES
     "${GLREMIX_SHIM_SOURCE_DIR}/scripts/generate_gl_wrappers.py"
     "${GLREMIX_SHIM_SOURCE_DIR}/scripts/generate_wgl_wrappers.py"
+    "${GLREMIX_SHIM_SOURCE_DIR}/scripts/generate_gl_commands.py"
 )
 
 set(GLREMIX_SHIM_ALL_FILES
@@ -5,7 +5,8 @@
     extern "C" __declspec(dllexport) void APIENTRY glRemix_##name params                           \
     {                                                                                              \
         using FnType = void(APIENTRY*) params;                                                     \
-        if (auto override_fn = reinterpret_cast<FnType>(glRemix::gl::find_hook(#name)))            \
+        constexpr auto hook_id = glRemix::gl::HookId::name;                                        \
+        if (auto override_fn = reinterpret_cast<FnType>(glRemix::gl::load_hook(hook_id)))          \
         {                                                                                          \
             override_fn args;                                                                      \
             return;                                                                                \
@@ -19,7 +20,8 @@
     extern "C" __declspec(dllexport) ret APIENTRY glRemix_##name params                            \
     {                                                                                              \
         using FnType = ret(APIENTRY*) params;                                                      \
-        if (auto override_fn = reinterpret_cast<FnType>(glRemix::gl::find_hook(#name)))            \
+        constexpr auto hook_id = glRemix::gl::HookId::name;                                        \
+        if (auto override_fn = reinterpret_cast<FnType>(glRemix::gl::load_hook(hook_id)))          \
         {                                                                                          \
             return override_fn args;                                                               \
         }                                                                                          \
@@ -33,7 +35,8 @@
     extern "C" __declspec(dllexport) retType WINAPI glRemix_##name params                          \
     {                                                                                              \
         using FnType = retType(WINAPI*) params;                                                    \
-        if (auto override_fn = reinterpret_cast<FnType>(glRemix::gl::find_hook(#name)))            \
+        constexpr auto hook_id = glRemix::gl::HookId::name;                                        \
+        if (auto override_fn = reinterpret_cast<FnType>(glRemix::gl::load_hook(hook_id)))          \
         {                                                                                          \
             return override_fn args;                                                               \
         }                                                                                          \
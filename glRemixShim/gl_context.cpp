@@ -0,0 +1,123 @@
+#include "gl_context.h"
+
+#include <gl_loader.h>
+
+#include <array>
+#include <mutex>
+
+namespace glRemix::hooks
+{
+// handles are fake, the stream index is all the shim needs to find a context again
+constexpr UINT_PTR k_CONTEXT_HANDLE_BASE = 0xDEADBEEF;
+
+// indexed by stream, entries outlive their contexts so a stream's ring can be reused
+static std::array<GLContext, k_IPC_MAX_STREAMS> g_contexts = []
+{
+    std::array<GLContext, k_IPC_MAX_STREAMS> contexts;
+    for (UINT32 stream = 0; stream < k_IPC_MAX_STREAMS; stream++)
+    {
+        contexts[stream].stream = stream;
+    }
+    contexts[0].ipc = &g_ipc;
+    return contexts;
+}();
+
+// WGL calls may come from any thread, recording only from the one a context is current on
+static std::mutex g_context_mutex;
+
+thread_local GLContext* g_context = &g_contexts[0];
+
+GLContext& get_default_context()
+{
+    return g_contexts[0];
+}
+
+GLContext* create_context()
+{
+    std::scoped_lock lock(g_context_mutex);
+
+    for (GLContext& context : g_contexts)
+    {
+        if (context.in_use)
+        {
+            continue;
+        }
+
+        // a reused stream continues where the deleted context stopped
+        if (!context.ipc)
+        {
+            context.owned_ipc = gl::create_stream(context.stream);
+            context.ipc = context.owned_ipc.get();
+        }
+
+        context.state_mirror = GLStateMirror{};
+        context.state_filter = GLStateFilter{};
+        context.vertex_batch = GLVertexBatch{};
+        context.compiling_list = false;
+        context.locked_arrays = {};
+        context.locked_first = 0;
+        context.locked_count = 0;
+        context.in_use = true;
+
+        g_ipc.set_share_group(context.stream, context.stream);
+        return &context;
+    }
+
+    return nullptr;
+}
+
+void delete_context(GLContext* context)
+{
+    std::scoped_lock lock(g_context_mutex);
+
+    if (!context->in_use)
+    {
+        return;
+    }
+
+    // whatever it created must reach the renderer, other contexts may share it
+    flush_context(*context);
+    context->in_use = false;
+}
+
+GLContext* find_context(const HGLRC handle)
+{
+    const UINT_PTR value = reinterpret_cast<UINT_PTR>(handle);
+    if (value < k_CONTEXT_HANDLE_BASE || value - k_CONTEXT_HANDLE_BASE >= k_IPC_MAX_STREAMS)
+    {
+        return nullptr;
+    }
+
+    GLContext& context = g_contexts[value - k_CONTEXT_HANDLE_BASE];
+    return context.in_use ? &context : nullptr;
+}
+
+HGLRC get_context_handle(const GLContext& context)
+{
+    return reinterpret_cast<HGLRC>(k_CONTEXT_HANDLE_BASE + context.stream);
+}
+
+void share_lists(const GLContext& source, const GLContext& target)
+{
+    g_ipc.set_share_group(target.stream, g_ipc.get_share_group(source.stream));
+}
+
+void flush_context(GLContext& context)
+{
+    if (context.stream == 0 || !context.ipc->is_writer_thread())
+    {
+        return;
+    }
+
+    report_elided_commands(context);
+    context.ipc->end_frame();
+    context.ipc->start_frame_or_wait();
+    context.state_mirror.sync(*context.ipc);
+}
+
+void report_elided_commands(GLContext& context)
+{
+    context.ipc->report_elided_commands(context.state_filter.take_elided_commands(),
+                                        context.state_filter.take_elided_bytes());
+}
+}  // namespace glRemix::hooks
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "gl_hooks.h"
+#include "gl_state_filter.h"
+#include "gl_state_mirror.h"
+#include "gl_vertex_batch.h"
+
+#include <shared/ipc_protocol.h>
+
+#include <framework.h>
+
+#include <array>
+#include <memory>
+
+namespace glRemix::hooks
+{
+/*
+ * One per HGLRC. Every context records into its own IPC stream, so loading contexts and tool
+ * windows never interleave their commands with the window the renderer presents.
+ * Stream 0 is `g_ipc` and belongs to the first context alive, the others are created on demand
+ * and kept for later contexts. The thread a context is current on writes its stream, threads
+ * recording without one go through stream 0's thread buffers (`IPCProtocol::set_writer_thread`).
+ */
+struct GLContext
+{
+    UINT32 stream = 0;
+    IPCProtocol* ipc = nullptr;  // `g_ipc` for stream 0, else `owned_ipc`
+    std::unique_ptr<IPCProtocol> owned_ipc;
+    GLStateMirror state_mirror;   // answers `glGet*` without asking the renderer
+    GLStateFilter state_filter;   // drops state calls that change nothing
+    GLVertexBatch vertex_batch;   // between `glBegin` and `glEnd`
+    bool compiling_list = false;  // between `glNewList` and `glEndList`
+
+    // arrays as the last `glLockArraysEXT` shipped them, `locked_count` 0 while unlocked
+    std::array<GLRemixClientArrayInterface, NUM_CLIENT_ARRAYS> locked_arrays{};
+    UINT32 locked_first = 0;
+    UINT32 locked_count = 0;
+
+    bool in_use = false;
+};
+
+// context current on this thread, stream 0's while none is
+extern thread_local GLContext* g_context;
+
+GLContext& get_default_context();
+
+// takes the lowest free stream, nullptr once all `k_IPC_MAX_STREAMS` are in use
+GLContext* create_context();
+void delete_context(GLContext* context);
+
+// nullptr for handles `create_context` never returned
+GLContext* find_context(HGLRC handle);
+HGLRC get_context_handle(const GLContext& context);
+
+// `target` uses the display lists and textures of `source`'s share group from now on
+void share_lists(const GLContext& source, const GLContext& target);
+
+/*
+ * Publishes what a context other than stream 0's recorded, like GL does on `glFlush` or when a
+ * context stops being current. Stream 0 only publishes at `SwapBuffers` so frames stay whole.
+ * Only the stream's writer thread may flush, on other threads this does nothing.
+ */
+void flush_context(GLContext& context);
+
+// hands the frame's `GLStateFilter` savings to the renderer, before the frame ends
+void report_elided_commands(GLContext& context);
+}  // namespace glRemix::hooks
@@ -1,2 +1,3 @@
 GLREMIX_EXT("GL_ARB_multitexture")
+GLREMIX_EXT("GL_EXT_compiled_vertex_array")
 GLREMIX_EXT("WGL_EXT_swap_control_tear")
@@ -1,18 +1,28 @@
 #include "gl_hooks.h"
+#include "gl_context.h"
 
 #include <gl_loader.h>
 #include <shared/gl_utils.h>
+#include <shared/hash_utils.h>
+
+#include <tsl/robin_set.h>
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
 
 namespace glRemix::hooks
 {
 
-static UINT32 g_gen_lists_count = 1;     // monotonic int, passed back to host app in `glGenLists`
-static UINT32 g_gen_textures_count = 1;  // monotonic int, passed back in `glGenTextures`
+// monotonic ints, shared by all contexts and threads so names never collide across share groups
+static std::atomic<UINT32> g_gen_lists_count = 1;     // passed back to host app in `glGenLists`
+static std::atomic<UINT32> g_gen_textures_count = 1;  // passed back in `glGenTextures`
 
+// client array state is per thread, like the records that capture it
 thread_local std::array<GLRemixClientArrayInterface, NUM_CLIENT_ARRAYS> g_client_arrays{};
-static UINT32 g_enabled_client_arrays_count = 0;  // count of currently enabled client arrays
+thread_local UINT32 g_enabled_client_arrays_count = 0;  // count of currently enabled client arrays
 
-// Assume WGL/OpenGL not called from multiple threads
+// GL calls record into `g_context`, the context current on the calling thread
 
 // wglSetPixelFormat will only be called once per context
 // Or if there are multiple contexts they can share the same format since they're fake anyway...
@@ -24,85 +34,186 @@ thread_local HDC g_current_dc = nullptr;
 // Window procedure subclassing
 static WNDPROC g_original_wndproc = nullptr;
 
+// smaller uploads are cheaper to resend than to hash and look up
+constexpr UINT32 k_MIN_CACHED_TEXTURE_BYTES = 4 * 1024;
+
+// client arrays the renderer may keep resident, see `s_fingerprint_client_array`
+constexpr UINT32 k_MIN_RESIDENT_ARRAY_BYTES = 1024;
+constexpr UINT32 k_CLIENT_ARRAY_SAMPLES = 16;        // words the sampled hash reads
+constexpr SIZE_T k_MAX_SAMPLED_CLIENT_ARRAYS = 4096;  // forgotten all at once beyond this
+
+// sampled hashes of the arrays drawn on this thread, a repeat is worth the full hash
+thread_local tsl::robin_set<UINT64> g_sampled_client_arrays;
+
 /* CORE IMMEDIATE MODE */
+// between glBegin and glEnd calls only feed the context's vertex batch, see `GLVertexBatch`
+// drops calls that leave the current state as it is, lists being compiled keep every command
+template<typename T, typename Command = T>
+static bool s_elide(const GLFilteredState state, const T& value)
+{
+    const UINT32 record_bytes = align_u32(
+        GLCommandHeader::get_bytes_for(sizeof(Command)) + sizeof(Command), k_IPC_RECORD_ALIGNMENT);
+    return !g_context->compiling_list
+           && g_context->state_filter.elide(state, value, record_bytes);
+}
+
+static bool s_elide_cap(const GLenum cap, const bool enabled)
+{
+    const UINT32 record_bytes = align_u32(
+        GLCommandHeader::get_bytes_for(sizeof(GLEnableCommand)) + sizeof(GLEnableCommand),
+        k_IPC_RECORD_ALIGNMENT);
+    return !g_context->compiling_list
+           && g_context->state_filter.elide_cap(cap, enabled, record_bytes);
+}
+
 void APIENTRY gl_begin_ovr(GLenum mode)
 {
-    GLBeginCommand payload{ mode };
-    g_ipc.write_command(GLCommandType::GLCMD_BEGIN, payload);
+    g_context->vertex_batch.begin(mode);
 }
 
 void APIENTRY gl_end_ovr()
 {
-    GLEmptyCommand payload{};  // init with default 0 value
-    g_ipc.write_command(GLCommandType::GLCMD_END, payload);
+    if (!g_context->vertex_batch.is_recording())
+    {
+        g_context->state_mirror.set_error(GL_INVALID_OPERATION);
+        return;
+    }
+    g_context->vertex_batch.end(*g_context->ipc);
+
+    // the renderer keeps the batch's last color and normal as the current ones
+    g_context->state_filter.forget(GLFilteredState::COLOR);
+    g_context->state_filter.forget(GLFilteredState::NORMAL);
 }
 
 void APIENTRY gl_vertex2f_ovr(GLfloat x, GLfloat y)
 {
-    GLVertex2fCommand payload{ x, y };
-    g_ipc.write_command(GLCommandType::GLCMD_VERTEX2F, payload);
+    if (g_context->vertex_batch.is_recording())
+    {
+        g_context->vertex_batch.vertex({ x, y, 0.0f });
+        return;
+    }
+    IPCProtocol& ipc = *g_context->ipc;
+    *ipc.reserve<GLCommandType::GLCMD_VERTEX2F>() = { x, y };
+    ipc.commit();
 }
 
 void APIENTRY gl_vertex3f_ovr(GLfloat x, GLfloat y, GLfloat z)
 {
-    GLVertex3fCommand payload{ x, y, z };
-    g_ipc.write_command(GLCommandType::GLCMD_VERTEX3F, payload);
+    if (g_context->vertex_batch.is_recording())
+    {
+        g_context->vertex_batch.vertex({ x, y, z });
+        return;
+    }
+    IPCProtocol& ipc = *g_context->ipc;
+    *ipc.reserve<GLCommandType::GLCMD_VERTEX3F>() = { x, y, z };
+    ipc.commit();
 }
 
 void APIENTRY gl_vertex3fv_ovr(const GLfloat* v)
 {
-    GLVertex3fCommand payload{ v[0], v[1], v[2] };
-    g_ipc.write_command(GLCommandType::GLCMD_VERTEX3F, payload);
+    gl_vertex3f_ovr(v[0], v[1], v[2]);
 }
 
 void APIENTRY gl_color3f_ovr(GLfloat r, GLfloat g, GLfloat b)
 {
+    if (g_context->vertex_batch.is_recording())
+    {
+        g_context->vertex_batch.color({ r, g, b, 1.0f });
+        return;
+    }
+    if (s_elide<GLVec4f, GLColor3fCommand>(GLFilteredState::COLOR, GLVec4f{ r, g, b, 1.0f }))
+    {
+        return;
+    }
     GLColor3fCommand payload{ r, g, b };
-    g_ipc.write_command(GLCommandType::GLCMD_COLOR3F, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_COLOR3F>(payload);
 }
 
 void APIENTRY gl_color4f_ovr(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
 {
+    if (g_context->vertex_batch.is_recording())
+    {
+        g_context->vertex_batch.color({ r, g, b, a });
+        return;
+    }
     GLColor4fCommand payload{ r, g, b, a };
-    g_ipc.write_command(GLCommandType::GLCMD_COLOR4F, payload);
+    if (s_elide(GLFilteredState::COLOR, payload))
+    {
+        return;
+    }
+    g_context->ipc->write_command<GLCommandType::GLCMD_COLOR4F>(payload);
 }
 
 void APIENTRY gl_normal3f_ovr(GLfloat nx, GLfloat ny, GLfloat nz)
 {
+    if (g_context->vertex_batch.is_recording())
+    {
+        g_context->vertex_batch.normal({ nx, ny, nz });
+        return;
+    }
     GLNormal3fCommand payload{ nx, ny, nz };
-    g_ipc.write_command(GLCommandType::GLCMD_NORMAL3F, payload);
+    if (s_elide(GLFilteredState::NORMAL, payload))
+    {
+        return;
+    }
+    g_context->ipc->write_command<GLCommandType::GLCMD_NORMAL3F>(payload);
 }
 
 void APIENTRY gl_tex_coord2f_ovr(GLfloat s, GLfloat t)
 {
-    GLTexCoord2fCommand payload{ s, t };
-    g_ipc.write_command(GLCommandType::GLCMD_TEXCOORD2F, payload);
+    if (g_context->vertex_batch.is_recording())
+    {
+        g_context->vertex_batch.tex_coord({ s, t });
+        return;
+    }
+    IPCProtocol& ipc = *g_context->ipc;
+    *ipc.reserve<GLCommandType::GLCMD_TEXCOORD2F>() = { s, t };
+    ipc.commit();
 }
 
 /* DISPLAY LISTS */
 void APIENTRY gl_call_list_ovr(GLuint list)
 {
-    GLCallListCommand payload{ list };
-    g_ipc.write_command(GLCommandType::GLCMD_CALL_LIST, payload);
+    IPCProtocol& ipc = *g_context->ipc;
+    ipc.reserve<GLCommandType::GLCMD_CALL_LIST>()->list = list;
+    ipc.commit();
+    g_context->state_filter.forget_all();  // the list may set anything
 }
 
 void APIENTRY gl_new_list_ovr(GLuint list, GLenum mode)
 {
+    if (g_context->compiling_list)
+    {
+        g_context->state_mirror.set_error(GL_INVALID_OPERATION);
+        return;
+    }
+
     GLNewListCommand payload{ list, mode };
-    g_ipc.write_command(GLCommandType::GLCMD_NEW_LIST, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_NEW_LIST>(payload);
+    g_context->compiling_list = true;
+    g_context->state_mirror.set(GL_LIST_INDEX, list);
+    g_context->state_mirror.set(GL_LIST_MODE, mode);
 }
 
 void APIENTRY gl_end_list_ovr()
 {
+    if (!g_context->compiling_list)
+    {
+        g_context->state_mirror.set_error(GL_INVALID_OPERATION);
+        return;
+    }
+
     GLEndListCommand payload{};
-    g_ipc.write_command(GLCommandType::GLCMD_END_LIST, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_END_LIST>(payload);
+    g_context->compiling_list = false;
+    g_context->state_filter.forget_all();  // GL_COMPILE_AND_EXECUTE ran what it compiled
+    g_context->state_mirror.set(GL_LIST_INDEX, 0);
+    g_context->state_mirror.set(GL_LIST_MODE, 0);
 }
 
 GLuint APIENTRY gl_gen_lists_ovr(GLsizei range)
 {
-    // fetchandadd
-    GLuint base = static_cast<GLuint>(g_gen_lists_count);
-    g_gen_lists_count += range;
+    GLuint base = static_cast<GLuint>(g_gen_lists_count.fetch_add(range));
 
     return base;
 }
@@ -115,6 +226,7 @@ void APIENTRY gl_enable_client_state_ovr(GLenum array)
     GLRemixClientArrayType array_type = utils::MapTo(array);
     if (array_type == GLRemixClientArrayType::_INVALID)
     {
+        g_context->state_mirror.set_error(GL_INVALID_ENUM);
         return;
     }
 
@@ -124,6 +236,7 @@ void APIENTRY gl_enable_client_state_ovr(GLenum array)
     {
         target->enabled = true;
         g_enabled_client_arrays_count++;
+        g_context->state_mirror.set(array, GL_TRUE);
     }
 
     return;  // do NOT send to IPC
@@ -136,6 +249,7 @@ void APIENTRY gl_disable_client_state_ovr(GLenum array)
     GLRemixClientArrayType array_type = utils::MapTo(array);
     if (array_type == GLRemixClientArrayType::_INVALID)
     {
+        g_context->state_mirror.set_error(GL_INVALID_ENUM);
         return;
     }
 
@@ -145,6 +259,7 @@ void APIENTRY gl_disable_client_state_ovr(GLenum array)
     {
         target->enabled = false;
         g_enabled_client_arrays_count--;
+        g_context->state_mirror.set(array, GL_FALSE);
     }
 
     return;
@@ -155,8 +270,8 @@ void APIENTRY gl_vertex_pointer_ovr(GLint size, GLenum type, GLsizei stride, con
     GLRemixClientArrayType array_type = GLRemixClientArrayType::VERTEX;
 
     GLRemixClientArrayInterface& a = g_client_arrays[static_cast<UINT32>(array_type)];
-    a.ipc_payload.size = static_cast<UINT32>(size);
-    a.ipc_payload.type = static_cast<UINT32>(type);
+    a.ipc_payload.size = static_cast<UINT8>(size);
+    a.ipc_payload.type = static_cast<UINT16>(type);
     a.ipc_payload.stride = utils::InterpretStride(size, type, stride);
     a.ipc_payload.array_type = array_type;
     a.ptr = pointer;
@@ -168,8 +283,8 @@ void APIENTRY gl_normal_pointer_ovr(GLenum type, GLsizei stride, const void* poi
     GLRemixClientArrayType array_type = GLRemixClientArrayType::NORMAL;
 
     GLRemixClientArrayInterface& a = g_client_arrays[static_cast<UINT32>(array_type)];
-    a.ipc_payload.size = static_cast<UINT32>(3);
-    a.ipc_payload.type = static_cast<UINT32>(type);
+    a.ipc_payload.size = 3;
+    a.ipc_payload.type = static_cast<UINT16>(type);
     a.ipc_payload.stride = utils::InterpretStride(3, type, stride);
     a.ipc_payload.array_type = array_type;
     a.ptr = pointer;
@@ -181,8 +296,8 @@ void APIENTRY gl_color_pointer_ovr(GLint size, GLenum type, GLsizei stride, cons
     GLRemixClientArrayType array_type = GLRemixClientArrayType::COLOR;
 
     GLRemixClientArrayInterface& a = g_client_arrays[static_cast<UINT32>(array_type)];
-    a.ipc_payload.size = static_cast<UINT32>(size);
-    a.ipc_payload.type = static_cast<UINT32>(type);
+    a.ipc_payload.size = static_cast<UINT8>(size);
+    a.ipc_payload.type = static_cast<UINT16>(type);
     a.ipc_payload.stride = utils::InterpretStride(size, type, stride);
     a.ipc_payload.array_type = array_type;
     a.ptr = pointer;
@@ -194,8 +309,8 @@ void APIENTRY gl_tex_coord_pointer_ovr(GLint size, GLenum type, GLsizei stride,
     GLRemixClientArrayType array_type = GLRemixClientArrayType::TEXCOORD;
 
     GLRemixClientArrayInterface& a = g_client_arrays[static_cast<UINT32>(array_type)];
-    a.ipc_payload.size = static_cast<UINT32>(size);
-    a.ipc_payload.type = static_cast<UINT32>(type);
+    a.ipc_payload.size = static_cast<UINT8>(size);
+    a.ipc_payload.type = static_cast<UINT16>(type);
     a.ipc_payload.stride = utils::InterpretStride(size, type, stride);
     a.ipc_payload.array_type = array_type;
     a.ptr = pointer;
@@ -207,8 +322,8 @@ void APIENTRY gl_index_pointer_ovr(GLint size, GLenum type, GLsizei stride, cons
     GLRemixClientArrayType array_type = GLRemixClientArrayType::COLORIDX;
 
     GLRemixClientArrayInterface& a = g_client_arrays[static_cast<UINT32>(array_type)];
-    a.ipc_payload.size = static_cast<UINT32>(size);
-    a.ipc_payload.type = static_cast<UINT32>(type);
+    a.ipc_payload.size = static_cast<UINT8>(size);
+    a.ipc_payload.type = static_cast<UINT16>(type);
     a.ipc_payload.stride = utils::InterpretStride(size, type, stride);
     a.ipc_payload.array_type = array_type;
     a.ptr = pointer;
@@ -220,15 +335,92 @@ void APIENTRY gl_edge_flag_pointer_ovr(GLint size, GLenum type, GLsizei stride,
     GLRemixClientArrayType array_type = GLRemixClientArrayType::EDGEFLAG;
 
     GLRemixClientArrayInterface& a = g_client_arrays[static_cast<UINT32>(array_type)];
-    a.ipc_payload.size = static_cast<UINT32>(size);
-    a.ipc_payload.type = static_cast<UINT32>(type);
+    a.ipc_payload.size = static_cast<UINT8>(size);
+    a.ipc_payload.type = static_cast<UINT16>(type);
     a.ipc_payload.stride = utils::InterpretStride(size, type, stride);
     a.ipc_payload.array_type = array_type;
     a.ptr = pointer;
     return;
 }
 
-static UINT32 s_precompute_client_payload_bytes(GLsizei count)
+// a few words spread over the array, the same pointer and words again likely mean static data
+static UINT64 s_sample_client_array(const GLRemixClientArrayHeader& h, const UINT8* data)
+{
+    UINT64 hash = hash_content(&h, sizeof(h), reinterpret_cast<UINT_PTR>(data));
+    const UINT32 step = (h.array_bytes - sizeof(UINT64)) / (k_CLIENT_ARRAY_SAMPLES - 1);
+    for (UINT32 i = 0; i < k_CLIENT_ARRAY_SAMPLES; i++)
+    {
+        UINT64 word;
+        memcpy(&word, data + i * step, sizeof(word));
+        hash = hash_round(hash, word);
+    }
+    return hash;
+}
+
+/*
+ * Decides how an array crosses the ring. Arrays whose sampled hash shows up again get the exact
+ * hash of their bytes, which is the id the renderer keeps them under. Once it acknowledged the
+ * id only the header is sent. Arrays the game rewrites every draw rarely repeat a sample, so
+ * they skip the full hash. Lists may be replayed after the renderer dropped an array, they
+ * always send the bytes.
+ */
+static void s_fingerprint_client_array(GLRemixClientArrayHeader& h, const UINT8* data)
+{
+    h.residency = GLRemixArrayResidency::SENT;
+    h.content_hash = {};
+    if (g_context->compiling_list || h.array_bytes < k_MIN_RESIDENT_ARRAY_BYTES)
+    {
+        return;
+    }
+
+    if (g_sampled_client_arrays.size() >= k_MAX_SAMPLED_CLIENT_ARRAYS)
+    {
+        g_sampled_client_arrays.clear();
+    }
+    if (g_sampled_client_arrays.insert(s_sample_client_array(h, data)).second)
+    {
+        return;
+    }
+
+    // the descriptor seeds the hash, the same bytes read as another type are another array
+    const UINT64 seed = hash_content(&h, sizeof(h));
+    const UINT64 hash = std::max<UINT64>(hash_content(data, h.array_bytes, seed), 1);
+    h.content_hash = { static_cast<UINT32>(hash), static_cast<UINT32>(hash >> 32) };
+    h.residency = g_context->ipc->is_content_acknowledged(hash) ? GLRemixArrayResidency::RESIDENT
+                                                                 : GLRemixArrayResidency::CACHE;
+}
+
+// start of the bytes sent for an array, the indices are sent whole
+static const UINT8* s_client_array_data(const GLRemixClientArrayInterface& a, const UINT32 first)
+{
+    const bool indices = a.ipc_payload.array_type == GLRemixClientArrayType::INDICES;
+    return static_cast<const UINT8*>(a.ptr) + (indices ? 0 : first * a.ipc_payload.stride);
+}
+
+// the array is still the one the current lock shipped, so the renderer already has its vertices
+static bool s_is_locked(const GLRemixClientArrayInterface& a)
+{
+    const GLRemixClientArrayInterface& l = g_context->locked_arrays[static_cast<UINT32>(
+        a.ipc_payload.array_type)];
+    return l.enabled && l.ptr == a.ptr && l.ipc_payload.size == a.ipc_payload.size
+           && l.ipc_payload.type == a.ipc_payload.type
+           && l.ipc_payload.stride == a.ipc_payload.stride;
+}
+
+// only these residencies send bytes after the headers
+static bool s_sends_bytes(const GLRemixClientArrayHeader& h)
+{
+    return h.residency == GLRemixArrayResidency::SENT
+           || h.residency == GLRemixArrayResidency::CACHE;
+}
+
+/*
+ * Sizes and fingerprints the enabled arrays from vertex `first` on, returns the bytes that have
+ * to follow the headers. `index_count` is only for the `INDICES` array, the others hold
+ * `vertex_count` elements. With `locked` the arrays the current lock shipped send no bytes.
+ */
+static UINT32 s_precompute_client_payload_bytes(const UINT32 first, GLsizei vertex_count,
+                                                GLsizei index_count = 0, const bool locked = false)
 {
     UINT32 total_bytes = 0;
     for (GLRemixClientArrayInterface& a : g_client_arrays)
@@ -238,115 +430,146 @@ static UINT32 s_precompute_client_payload_bytes(GLsizei count)
             continue;
         }
 
-        const UINT32 a_bytes = utils::ComputeClientArraySize(count, a.ipc_payload.size,
+        const bool indices = a.ipc_payload.array_type == GLRemixClientArrayType::INDICES;
+        const UINT32 a_bytes = utils::ComputeClientArraySize(indices ? index_count : vertex_count,
+                                                             a.ipc_payload.size,
                                                              a.ipc_payload.type,
                                                              a.ipc_payload.stride);
 
         a.ipc_payload.array_bytes = a_bytes;
-        total_bytes += a_bytes;
+        if (locked && !indices && s_is_locked(a))
+        {
+            a.ipc_payload.residency = GLRemixArrayResidency::LOCKED;
+            a.ipc_payload.content_hash = {};
+            continue;
+        }
+
+        s_fingerprint_client_array(a.ipc_payload, s_client_array_data(a, first));
+        if (s_sends_bytes(a.ipc_payload))
+        {
+            total_bytes += a_bytes;
+        }
     }
 
     return total_bytes;
 }
 
-static void s_fill_client_array_headers(GLRemixClientArrayHeader (&out)[NUM_CLIENT_ARRAYS])
+// the renderer reuses bulk memory after the frame, but replays display lists much later
+static UINT8* s_reserve_bulk(UINT32 bytes, GLBulkHandle* handle)
 {
-    SIZE_T curr = 0;
-    for (const GLRemixClientArrayInterface& i : g_client_arrays)
+    if (g_context->compiling_list)
     {
-        if (i.enabled)
-        {
-            out[curr] = i.ipc_payload;
-            curr++;
-        }
+        *handle = {};
+        return nullptr;
     }
+    return g_context->ipc->reserve_bulk(bytes, handle);
 }
 
-void APIENTRY gl_draw_arrays_ovr(GLenum mode, GLint first, GLsizei count)
+// appends to the bulk allocation if the command got one, else to the command record itself
+static void s_write_client_array(UINT8*& bulk, const void* src, UINT32 bytes)
 {
-    // precompute size of all currently enabled client arrays
-    const UINT32 extra_data_bytes = s_precompute_client_payload_bytes(count);
-
-    GLRemixDrawArraysCommand payload{
-        .mode = static_cast<UINT32>(mode),                             // mode
-        .first = static_cast<UINT32>(first),                           // first
-        .count = static_cast<UINT32>(count),                           // count
-        .enabled = static_cast<UINT32>(g_enabled_client_arrays_count)  // enabled
-    };
-
-    s_fill_client_array_headers(payload.headers);
-
-    // pass in `extra_data_bytes` but pass in the actual extra data pointers later
-    g_ipc.write_command(GLCommandType::GLREMIXCMD_DRAW_ARRAYS, payload, extra_data_bytes, false,
-                        nullptr);
+    if (bulk)
+    {
+        memcpy(bulk, src, bytes);
+        bulk += bytes;
+        return;
+    }
+    g_context->ipc->write_simple(src, bytes);
+}
 
+// enabled arrays from vertex `first` on, in header order, resident and locked ones are skipped
+static void s_write_client_arrays(UINT8*& bulk, const UINT32 first)
+{
     for (const GLRemixClientArrayInterface& a : g_client_arrays)
     {
-        if (!a.enabled)
+        if (!a.enabled || !s_sends_bytes(a.ipc_payload))
         {
             continue;
         }
 
-        // factor in desired offset
-        const UINT8* a_ptr = reinterpret_cast<const UINT8*>(a.ptr) + (first * a.ipc_payload.stride);
-
         // write pointer to this extra data directly
-        g_ipc.write_simple(a_ptr, a.ipc_payload.array_bytes);
+        s_write_client_array(bulk, s_client_array_data(a, first), a.ipc_payload.array_bytes);
     }
 }
 
-static UINT32 s_read_index(SIZE_T i, GLenum type, const void* indices)
+// headers of the enabled arrays only, returns how many
+static UINT32 s_fill_client_array_headers(GLRemixClientArrayHeader (&out)[NUM_CLIENT_ARRAYS])
 {
-    switch (type)
-    {
-        case GL_UNSIGNED_BYTE:
-            return static_cast<UINT32>(reinterpret_cast<const UINT8*>(indices)[i]);
-        case GL_UNSIGNED_SHORT:
-            return static_cast<UINT32>(reinterpret_cast<const UINT16*>(indices)[i]);
-        case GL_UNSIGNED_INT:
-            return static_cast<UINT32>(reinterpret_cast<const UINT32*>(indices)[i]);
-    }
-    return 0;
-};
-
-static void s_draw_elements_base(GLsizei count, GLenum type, const void* indices)
-{
-    thread_local std::vector<UINT8> scratch_buffer;
-
-    for (const GLRemixClientArrayInterface& a : g_client_arrays)
+    UINT32 curr = 0;
+    for (const GLRemixClientArrayInterface& i : g_client_arrays)
     {
-        if (!a.enabled)
+        if (i.enabled)
         {
-            continue;
+            out[curr] = i.ipc_payload;
+            curr++;
         }
+    }
+    return curr;
+}
 
-        if (a.ipc_payload.array_type == GLRemixClientArrayType::INDICES)
-        {  // No need to scatter indices by themselves
-            g_ipc.write_simple(a.ptr, a.ipc_payload.array_bytes);
-            continue;
-        }
+// the headers go right after the command, `extra_data_bytes` must include them
+static void s_write_client_array_headers(const GLRemixClientArrayHeader* headers, UINT32 enabled)
+{
+    g_context->ipc->write_simple(headers, enabled * sizeof(GLRemixClientArrayHeader));
+}
 
-        const UINT8* a_ptr = reinterpret_cast<const UINT8*>(a.ptr);
+/*
+ * Writes a command followed by the enabled arrays' headers and data from vertex `first` on.
+ * `extra_data_bytes` comes from `s_precompute_client_payload_bytes`, the headers are added here.
+ */
+template<GLCommandType Type>
+static void s_write_client_array_command(typename GLCommandTraits<Type>::Payload& payload,
+                                         const UINT32 extra_data_bytes, const UINT32 first)
+{
+    GLRemixClientArrayHeader headers[NUM_CLIENT_ARRAYS];
+    payload.enabled = s_fill_client_array_headers(headers);
+    const UINT32 header_bytes = payload.enabled * sizeof(GLRemixClientArrayHeader);
 
-        const UINT32& a_bytes = a.ipc_payload.array_bytes;
-        const UINT32& a_stride = a.ipc_payload.stride;
+    UINT8* bulk = s_reserve_bulk(extra_data_bytes, &payload.client_data);
 
-        scratch_buffer.resize(a_bytes);
-        UINT8* dst_ptr = scratch_buffer.data();
+    // pass in `extra_data_bytes` but pass in the actual extra data pointers later
+    g_context->ipc->write_command<Type>(payload, header_bytes + (bulk ? 0 : extra_data_bytes),
+                                        false, nullptr);
+    s_write_client_array_headers(headers, payload.enabled);
+    s_write_client_arrays(bulk, first);
+}
 
-        /* SCATTER STEP */
-        for (UINT32 i = 0; i < static_cast<UINT32>(count); i++)
-        {
-            UINT32 idx = s_read_index(i, type, indices);
+void APIENTRY gl_draw_arrays_ovr(GLenum mode, GLint first, GLsizei count)
+{
+    // precompute size of all currently enabled client arrays
+    const UINT32 extra_data_bytes = s_precompute_client_payload_bytes(static_cast<UINT32>(first),
+                                                                      count);
 
-            const UINT8* src = a_ptr + (idx * a_stride);
-            UINT8* dst = dst_ptr + (i * a_stride);
+    GLRemixDrawArraysCommand payload{
+        .mode = static_cast<UINT32>(mode),    // mode
+        .first = static_cast<UINT32>(first),  // first
+        .count = static_cast<UINT32>(count),  // count
+        .enabled = 0,                         // set with the headers
+        .client_data = {},
+    };
+    s_write_client_array_command<GLCommandType::GLREMIXCMD_DRAW_ARRAYS>(payload, extra_data_bytes,
+                                                                        payload.first);
+}
 
-            memcpy(dst, src, a_stride);
-        }
+// [min, max] of the indices, the only vertices the draw reads
+template<typename Index>
+static std::pair<UINT32, UINT32> s_index_range(const void* indices, const GLsizei count)
+{
+    const auto* first = static_cast<const Index*>(indices);
+    const auto [lo, hi] = std::minmax_element(first, first + count);
+    return { *lo, *hi };
+}
 
-        g_ipc.write_simple(dst_ptr, a.ipc_payload.array_bytes);  // write pointer directly
+static std::pair<UINT32, UINT32> s_index_range(const GLenum type, const void* indices,
+                                               const GLsizei count)
+{
+    switch (type)
+    {
+        case GL_UNSIGNED_BYTE: return s_index_range<UINT8>(indices, count);
+        case GL_UNSIGNED_SHORT: return s_index_range<UINT16>(indices, count);
+        case GL_UNSIGNED_INT: return s_index_range<UINT32>(indices, count);
     }
+    return { 0, 0 };
 }
 
 /**
@@ -359,159 +582,271 @@ static void s_fake_gl_indices_pointer(GLenum type, const void* indices)
 
     GLRemixClientArrayInterface& a = g_client_arrays[static_cast<UINT32>(array_type)];
     a.ipc_payload.size = 1;
-    a.ipc_payload.type = static_cast<UINT32>(type);
+    a.ipc_payload.type = static_cast<UINT16>(type);
     a.ipc_payload.stride = utils::InterpretStride(1, type, 0);
     a.ipc_payload.array_type = array_type;
     a.enabled = true;
     a.ptr = indices;
 }
 
-void APIENTRY gl_draw_elements_ovr(GLenum mode, GLsizei count, GLenum type, const void* indices)
+/*
+ * Sends vertices [start, end] once and the indices as the game passed them, so vertices the
+ * indices share stay shared up to the BLAS. The renderer rebases the indices on `start`.
+ * Inside a locked range the draw covers the whole lock instead, the locked arrays send nothing
+ * and every draw of the lock builds on the same vertices.
+ */
+template<GLCommandType Type>
+static void s_draw_elements(const GLenum mode, UINT32 start, UINT32 end, const GLsizei count,
+                            const GLenum type, const void* indices)
 {
     s_fake_gl_indices_pointer(type, indices);
 
-    const UINT32 extra_data_bytes = s_precompute_client_payload_bytes(count);
+    // lists are replayed long after the lock, they keep their own copy
+    const GLRemixClientArrayInterface& vertices = g_client_arrays[static_cast<UINT32>(
+        GLRemixClientArrayType::VERTEX)];
+    const GLContext& context = *g_context;
+    const bool locked = context.locked_count != 0 && !context.compiling_list
+                        && s_is_locked(vertices) && start >= context.locked_first
+                        && end - context.locked_first < context.locked_count;
+    if (locked)
+    {
+        start = context.locked_first;
+        end = context.locked_first + context.locked_count - 1;
+    }
 
-    GLRemixDrawElementsCommand payload{ .mode = static_cast<UINT32>(mode),
-                                        .count = static_cast<UINT32>(count),
-                                        .type = static_cast<UINT32>(type),
-                                        .enabled = g_enabled_client_arrays_count };
+    const UINT32 extra_data_bytes = s_precompute_client_payload_bytes(start, end - start + 1,
+                                                                      count, locked);
+
+    typename GLCommandTraits<Type>::Payload payload{
+        .mode = static_cast<UINT32>(mode),
+        .start = start,
+        .end = end,
+        .count = static_cast<UINT32>(count),
+        .type = static_cast<UINT32>(type),
+        .enabled = 0,  // set with the headers
+        .client_data = {},
+    };
+    s_write_client_array_command<Type>(payload, extra_data_bytes, start);
 
-    s_fill_client_array_headers(payload.headers);
+    // the indices belong to this draw only, `glDrawArrays` must not send them along
+    g_client_arrays[static_cast<UINT32>(GLRemixClientArrayType::INDICES)].enabled = false;
+}
 
-    g_ipc.write_command(GLCommandType::GLREMIXCMD_DRAW_ELEMENTS, payload, extra_data_bytes, false,
-                        nullptr);
+void APIENTRY gl_draw_elements_ovr(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    if (count <= 0)
+    {
+        if (count < 0)
+        {
+            g_context->state_mirror.set_error(GL_INVALID_VALUE);
+        }
+        return;
+    }
 
-    s_draw_elements_base(count, type, indices);
+    const auto [start, end] = s_index_range(type, indices, count);
+    s_draw_elements<GLCommandType::GLREMIXCMD_DRAW_ELEMENTS>(mode, start, end, count, type,
+                                                             indices);
 }
 
 void APIENTRY gl_draw_range_elements_ovr(GLenum mode, GLuint start, GLuint end, GLsizei count,
                                          GLenum type, const void* indices)
 {
-    s_fake_gl_indices_pointer(type, indices);
+    if (count <= 0 || end < start)
+    {
+        if (count < 0 || end < start)
+        {
+            g_context->state_mirror.set_error(GL_INVALID_VALUE);
+        }
+        return;
+    }
+
+    // GL leaves indices outside [start, end] undefined, the renderer drops such draws
+    s_draw_elements<GLCommandType::GLREMIXCMD_DRAW_RANGE_ELEMENTS>(mode, start, end, count, type,
+                                                                   indices);
+}
+
+/*
+ * GL_EXT_compiled_vertex_array. The locked range crosses the ring once, `glDrawElements` calls
+ * inside it then send only their indices and the arrays that changed since.
+ */
+void APIENTRY gl_lock_arrays_EXT_ovr(GLint first, GLsizei count)
+{
+    if (first < 0 || count <= 0)
+    {
+        g_context->state_mirror.set_error(GL_INVALID_VALUE);
+        return;
+    }
+    if (g_context->locked_count != 0)
+    {
+        g_context->state_mirror.set_error(GL_INVALID_OPERATION);
+        return;
+    }
 
-    const UINT32 extra_data_bytes = s_precompute_client_payload_bytes(count);
+    g_context->locked_first = static_cast<UINT32>(first);
+    g_context->locked_count = static_cast<UINT32>(count);
 
-    GLRemixDrawRangeElementsCommand payload{ .mode = static_cast<UINT32>(mode),
-                                             .start = static_cast<UINT32>(start),
-                                             .count = static_cast<UINT32>(count),
-                                             .type = static_cast<UINT32>(type),
-                                             .enabled = g_enabled_client_arrays_count };
+    // a list would record the lock, so nothing is shipped and no draw references it
+    if (g_context->compiling_list)
+    {
+        g_context->locked_arrays = {};
+        return;
+    }
 
-    s_fill_client_array_headers(payload.headers);
+    const UINT32 extra_data_bytes = s_precompute_client_payload_bytes(static_cast<UINT32>(first),
+                                                                      count);
 
-    g_ipc.write_command(GLCommandType::GLREMIXCMD_DRAW_RANGE_ELEMENTS, payload, extra_data_bytes,
-                        false, nullptr);
+    GLRemixLockArraysCommand payload{
+        .first = static_cast<UINT32>(first),
+        .count = static_cast<UINT32>(count),
+        .enabled = 0,  // set with the headers
+        .client_data = {},
+    };
+    s_write_client_array_command<GLCommandType::GLREMIXCMD_LOCK_ARRAYS>(payload, extra_data_bytes,
+                                                                        payload.first);
+
+    g_context->locked_arrays = g_client_arrays;
+}
 
-    s_draw_elements_base(count, type, indices);
+// the renderer keeps the arrays until the next lock, no draw references them from here on
+void APIENTRY gl_unlock_arrays_EXT_ovr()
+{
+    if (g_context->locked_count == 0)
+    {
+        g_context->state_mirror.set_error(GL_INVALID_OPERATION);
+        return;
+    }
+    g_context->locked_count = 0;
 }
 
 /* MATRIX OPERATIONS */
 void APIENTRY gl_matrix_mode_ovr(GLenum mode)
 {
     GLMatrixModeCommand payload{ mode };
-    g_ipc.write_command(GLCommandType::GLCMD_MATRIX_MODE, payload);
+    if (s_elide(GLFilteredState::MATRIX_MODE, payload))
+    {
+        return;
+    }
+    g_context->ipc->write_command<GLCommandType::GLCMD_MATRIX_MODE>(payload);
+    g_context->state_mirror.set(GL_MATRIX_MODE, mode);
 }
 
 void APIENTRY gl_load_identity_ovr()
 {
-    GLLoadIdentityCommand payload{};
-    g_ipc.write_command(GLCommandType::GLCMD_LOAD_IDENTITY, payload);
+    IPCProtocol& ipc = *g_context->ipc;
+    *ipc.reserve<GLCommandType::GLCMD_LOAD_IDENTITY>() = {};
+    ipc.commit();
 }
 
 void APIENTRY gl_load_matrixf_ovr(const GLfloat* m)
 {
-    GLLoadMatrixCommand payload{};
-    memcpy(payload.m, m, sizeof(payload.m));
-    g_ipc.write_command(GLCommandType::GLCMD_LOAD_MATRIX, payload);
+    IPCProtocol& ipc = *g_context->ipc;
+    memcpy(ipc.reserve<GLCommandType::GLCMD_LOAD_MATRIX>()->m, m,
+           sizeof(GLLoadMatrixCommand::m));
+    ipc.commit();
 }
 
 void APIENTRY gl_mult_matrixf_ovr(const GLfloat* m)
 {
-    GLMultMatrixCommand payload{};
-    memcpy(payload.m, m, sizeof(payload.m));
-    g_ipc.write_command(GLCommandType::GLCMD_MULT_MATRIX, payload);
+    IPCProtocol& ipc = *g_context->ipc;
+    memcpy(ipc.reserve<GLCommandType::GLCMD_MULT_MATRIX>()->m, m,
+           sizeof(GLMultMatrixCommand::m));
+    ipc.commit();
 }
 
 void APIENTRY gl_push_matrix_ovr()
 {
-    GLPushMatrixCommand payload{};
-    g_ipc.write_command(GLCommandType::GLCMD_PUSH_MATRIX, payload);
+    IPCProtocol& ipc = *g_context->ipc;
+    *ipc.reserve<GLCommandType::GLCMD_PUSH_MATRIX>() = {};
+    ipc.commit();
 }
 
 void APIENTRY gl_pop_matrix_ovr()
 {
-    GLPopMatrixCommand payload{};
-    g_ipc.write_command(GLCommandType::GLCMD_POP_MATRIX, payload);
+    IPCProtocol& ipc = *g_context->ipc;
+    *ipc.reserve<GLCommandType::GLCMD_POP_MATRIX>() = {};
+    ipc.commit();
 }
 
 void APIENTRY gl_translatef_ovr(GLfloat x, GLfloat y, GLfloat z)
 {
-    GLTranslateCommand payload{ { x, y, z } };
-    g_ipc.write_command(GLCommandType::GLCMD_TRANSLATE, payload);
+    IPCProtocol& ipc = *g_context->ipc;
+    *ipc.reserve<GLCommandType::GLCMD_TRANSLATE>() = { { x, y, z } };
+    ipc.commit();
 }
 
 void APIENTRY gl_rotatef_ovr(GLfloat angle, GLfloat x, GLfloat y, GLfloat z)
 {
-    GLRotateCommand payload{ angle, { x, y, z } };
-    g_ipc.write_command(GLCommandType::GLCMD_ROTATE, payload);
+    IPCProtocol& ipc = *g_context->ipc;
+    *ipc.reserve<GLCommandType::GLCMD_ROTATE>() = { angle, { x, y, z } };
+    ipc.commit();
 }
 
 void APIENTRY gl_scalef_ovr(GLfloat x, GLfloat y, GLfloat z)
 {
-    GLScaleCommand payload{ { x, y, z } };
-    g_ipc.write_command(GLCommandType::GLCMD_SCALE, payload);
+    IPCProtocol& ipc = *g_context->ipc;
+    *ipc.reserve<GLCommandType::GLCMD_SCALE>() = { { x, y, z } };
+    ipc.commit();
 }
 
 void APIENTRY gl_viewport_ovr(GLint x, GLint y, GLsizei width, GLsizei height)
 {
     GLViewportCommand payload{ x, y, width, height };
-    g_ipc.write_command(GLCommandType::GLCMD_VIEWPORT, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_VIEWPORT>(payload);
+    g_context->state_mirror.set(GL_VIEWPORT, x, y, width, height);
 }
 
 void APIENTRY gl_ortho_ovr(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top,
                            GLdouble zNear, GLdouble zFar)
 {
     GLOrthoCommand payload{ left, right, bottom, top, zNear, zFar };
-    g_ipc.write_command(GLCommandType::GLCMD_ORTHO, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_ORTHO>(payload);
 }
 
 void APIENTRY gl_frustum_ovr(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top,
                              GLdouble zNear, GLdouble zFar)
 {
     GLFrustumCommand payload{ left, right, bottom, top, zNear, zFar };
-    g_ipc.write_command(GLCommandType::GLCMD_FRUSTUM, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_FRUSTUM>(payload);
 }
 
 /* RENDERING */
 void APIENTRY gl_clear_ovr(GLbitfield mask)
 {
-    GLClearCommand payload{ mask };
-    g_ipc.write_command(GLCommandType::GLCMD_CLEAR, payload);
+    IPCProtocol& ipc = *g_context->ipc;
+    ipc.reserve<GLCommandType::GLCMD_CLEAR>()->mask = mask;
+    ipc.commit();
 }
 
 void APIENTRY gl_clear_color_ovr(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
 {
     GLClearColorCommand payload{ { r, g, b, a } };
-    g_ipc.write_command(GLCommandType::GLCMD_CLEAR_COLOR, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_CLEAR_COLOR>(payload);
+    g_context->state_mirror.set(GL_COLOR_CLEAR_VALUE, r, g, b, a);
 }
 
 void APIENTRY gl_flush_ovr()
 {
     GLFlushCommand payload{};
-    g_ipc.write_command(GLCommandType::GLCMD_FLUSH, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_FLUSH>(payload);
+    flush_context(*g_context);
 }
 
 void APIENTRY gl_finish_ovr()
 {
     GLFinishCommand payload{};
-    g_ipc.write_command(GLCommandType::GLCMD_FINISH, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_FINISH>(payload);
+    flush_context(*g_context);
 }
 
 void APIENTRY gl_bind_texture_ovr(GLenum target, GLuint texture)
 {
     GLBindTextureCommand payload{ target, texture };
-    g_ipc.write_command(GLCommandType::GLCMD_BIND_TEXTURE, payload);
+    if (target == GL_TEXTURE_2D && s_elide(GLFilteredState::TEXTURE_BINDING, payload))
+    {
+        return;
+    }
+    g_context->ipc->write_command<GLCommandType::GLCMD_BIND_TEXTURE>(payload);
+    g_context->state_mirror.bind_texture(texture);
 }
 
 void APIENTRY gl_gen_textures_ovr(GLsizei n, GLuint* textures)
@@ -520,11 +855,11 @@ void APIENTRY gl_gen_textures_ovr(GLsizei n, GLuint* textures)
 
     for (GLsizei i = 0; i < n; i++)
     {
-        textures[i] = g_gen_textures_count++;
+        textures[i] = g_gen_textures_count.fetch_add(1);
         payload.ids[i] = textures[i];
     }
 
-    g_ipc.write_command(GLCommandType::GLCMD_GEN_TEXTURES, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_GEN_TEXTURES>(payload);
 }
 
 void APIENTRY gl_delete_textures_ovr(GLsizei n, const GLuint* textures)
@@ -534,9 +869,11 @@ void APIENTRY gl_delete_textures_ovr(GLsizei n, const GLuint* textures)
     for (GLsizei i = 0; i < n; i++)
     {
         payload.ids[i] = textures[i];
+        g_context->state_mirror.delete_texture(textures[i]);
     }
+    g_context->state_filter.forget(GLFilteredState::TEXTURE_BINDING);
 
-    g_ipc.write_command(GLCommandType::GLCMD_DELETE_TEXTURES, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_DELETE_TEXTURES>(payload);
 }
 
 /*
@@ -559,51 +896,74 @@ void APIENTRY gl_tex_image_2d_ovr(GLenum target, GLint level, GLint internalForm
 
     const UINT32 pixels_bytes = utils::ComputePixelDataSize(width, height, format, type);
 
-    g_ipc.write_command(GLCommandType::GLCMD_TEX_IMAGE_2D, payload, pixels_bytes, pixels != nullptr,
-                        pixels);
+    if (pixels && pixels_bytes >= k_MIN_CACHED_TEXTURE_BYTES)
+    {
+        // the descriptor seeds the hash so equal bytes with a different layout don't collide
+        const UINT64 seed = hash_content(&payload, sizeof(payload));
+        const UINT64 hash = std::max<UINT64>(hash_content(pixels, pixels_bytes, seed), 1);
+        payload.pixels_hash = { static_cast<UINT32>(hash), static_cast<UINT32>(hash >> 32) };
+
+        // renderer already holds this content, send the descriptor only
+        if (g_context->ipc->is_content_acknowledged(hash))
+        {
+            g_context->ipc->write_command<GLCommandType::GLCMD_TEX_IMAGE_2D_CACHED>(payload);
+            return;
+        }
+    }
+
+    // pixels go to the bulk arena when it has room, the ring then only carries the descriptor
+    if (UINT8* bulk = pixels ? s_reserve_bulk(pixels_bytes, &payload.pixels) : nullptr)
+    {
+        g_context->ipc->write_command<GLCommandType::GLCMD_TEX_IMAGE_2D>(payload);
+        memcpy(bulk, pixels, pixels_bytes);
+        return;
+    }
+
+    g_context->ipc->write_command<GLCommandType::GLCMD_TEX_IMAGE_2D>(payload, pixels_bytes,
+                                                                     pixels != nullptr, pixels);
 }
 
 void APIENTRY gl_tex_parameterf_ovr(GLenum target, GLenum pname, GLfloat param)
 {
     GLTexParameterCommand payload{ target, pname, param };
-    g_ipc.write_command(GLCommandType::GLCMD_TEX_PARAMETER, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_TEX_PARAMETER>(payload);
 }
 
 void APIENTRY gl_tex_envf_ovr(GLenum target, GLenum pname, GLfloat param)
 {
     GLTexEnvfCommand payload{ target, pname, param };
-    g_ipc.write_command(GLCommandType::GLCMD_TEX_ENV_F, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_TEX_ENV_F>(payload);
 }
 
 void APIENTRY gl_tex_envi_ovr(GLenum target, GLenum pname, GLint param)
 {
     GLTexEnviCommand payload{ target, pname, static_cast<UINT32>(param) };
-    g_ipc.write_command(GLCommandType::GLCMD_TEX_ENV_I, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_TEX_ENV_I>(payload);
 }
 
 /* FIXED FUNCTION */
 void APIENTRY gl_lightf_ovr(GLenum light, GLenum pname, GLfloat param)
 {
     GLLightCommand payload{ light, pname, param };
-    g_ipc.write_command(GLCommandType::GLCMD_LIGHTF, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_LIGHTF>(payload);
 }
 
 void APIENTRY gl_lightfv_ovr(GLenum light, GLenum pname, const GLfloat* params)
 {
     GLLightfvCommand payload{ light, pname, { params[0], params[1], params[2], params[3] } };
-    g_ipc.write_command(GLCommandType::GLCMD_LIGHTFV, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_LIGHTFV>(payload);
 }
 
 void APIENTRY gl_materiali_ovr(GLenum face, GLenum pname, GLint param)
 {
     GLMaterialiCommand payload{ face, pname, param };
-    g_ipc.write_command(GLCommandType::GLCMD_MATERIALI, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_MATERIALI>(payload);
 }
 
 void APIENTRY gl_materialf_ovr(GLenum face, GLenum pname, GLfloat param)
 {
     GLMaterialfCommand payload{ face, pname, param };
-    g_ipc.write_command(GLCommandType::GLCMD_MATERIALF, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_MATERIALF>(payload);
 }
 
 void APIENTRY gl_materialiv_ovr(GLenum face, GLenum pname, const GLint* params)
@@ -612,92 +972,135 @@ void APIENTRY gl_materialiv_ovr(GLenum face, GLenum pname, const GLint* params)
                                  pname,
                                  { static_cast<float>(params[0]), static_cast<float>(params[1]),
                                    static_cast<float>(params[2]), static_cast<float>(params[3]) } };
-    g_ipc.write_command(GLCommandType::GLCMD_MATERIALIV, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_MATERIALIV>(payload);
 }
 
 void APIENTRY gl_materialfv_ovr(GLenum face, GLenum pname, const GLfloat* params)
 {
     GLMaterialfvCommand payload{ face, pname, { params[0], params[1], params[2], params[3] } };
-    g_ipc.write_command(GLCommandType::GLCMD_MATERIALFV, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_MATERIALFV>(payload);
 }
 
 void APIENTRY gl_alpha_func_ovr(GLenum func, GLclampf ref)
 {
     GLAlphaFuncCommand payload{ func, ref };
-    g_ipc.write_command(GLCommandType::GLCMD_ALPHA_FUNC, payload);
+    if (s_elide(GLFilteredState::ALPHA_FUNC, payload))
+    {
+        return;
+    }
+    g_context->ipc->write_command<GLCommandType::GLCMD_ALPHA_FUNC>(payload);
+    g_context->state_mirror.set(GL_ALPHA_TEST_FUNC, func);
+    g_context->state_mirror.set(GL_ALPHA_TEST_REF, ref);
 }
 
 /* STATE MANAGEMENT */
 void APIENTRY gl_enable_ovr(GLenum cap)
 {
+    if (s_elide_cap(cap, true))
+    {
+        return;
+    }
     GLEnableCommand payload{ cap };
-    g_ipc.write_command(GLCommandType::GLCMD_ENABLE, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_ENABLE>(payload);
+    g_context->state_mirror.set(cap, GL_TRUE);
 }
 
 void APIENTRY gl_disable_ovr(GLenum cap)
 {
+    if (s_elide_cap(cap, false))
+    {
+        return;
+    }
     GLDisableCommand payload{ cap };
-    g_ipc.write_command(GLCommandType::GLCMD_DISABLE, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_DISABLE>(payload);
+    g_context->state_mirror.set(cap, GL_FALSE);
 }
 
 void APIENTRY gl_color_mask_ovr(GLboolean r, GLboolean g, GLboolean b, GLboolean a)
 {
     GLColorMaskCommand payload{ (UINT8)r, (UINT8)g, (UINT8)b, (UINT8)a };
-    g_ipc.write_command(GLCommandType::GLCMD_COLOR_MASK, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_COLOR_MASK>(payload);
+    g_context->state_mirror.set(GL_COLOR_WRITEMASK, r, g, b, a);
 }
 
 void APIENTRY gl_depth_mask_ovr(GLboolean flag)
 {
     GLDepthMaskCommand payload{ (UINT8)flag };
-    g_ipc.write_command(GLCommandType::GLCMD_DEPTH_MASK, payload);
+    if (s_elide(GLFilteredState::DEPTH_MASK, payload))
+    {
+        return;
+    }
+    g_context->ipc->write_command<GLCommandType::GLCMD_DEPTH_MASK>(payload);
+    g_context->state_mirror.set(GL_DEPTH_WRITEMASK, flag);
 }
 
 void APIENTRY gl_blend_func_ovr(GLenum sfactor, GLenum dfactor)
 {
     GLBlendFuncCommand payload{ sfactor, dfactor };
-    g_ipc.write_command(GLCommandType::GLCMD_BLEND_FUNC, payload);
+    if (s_elide(GLFilteredState::BLEND_FUNC, payload))
+    {
+        return;
+    }
+    g_context->ipc->write_command<GLCommandType::GLCMD_BLEND_FUNC>(payload);
+    g_context->state_mirror.set(GL_BLEND_SRC, sfactor);
+    g_context->state_mirror.set(GL_BLEND_DST, dfactor);
 }
 
 void APIENTRY gl_point_size_ovr(GLfloat size)
 {
     GLPointSizeCommand payload{ size };
-    g_ipc.write_command(GLCommandType::GLCMD_POINT_SIZE, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_POINT_SIZE>(payload);
+    g_context->state_mirror.set(GL_POINT_SIZE, size);
 }
 
 void APIENTRY gl_polygon_offset_ovr(GLfloat factor, GLfloat units)
 {
     GLPolygonOffsetCommand payload{ factor, units };
-    g_ipc.write_command(GLCommandType::GLCMD_POLYGON_OFFSET, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_POLYGON_OFFSET>(payload);
+    g_context->state_mirror.set(GL_POLYGON_OFFSET_FACTOR, factor);
+    g_context->state_mirror.set(GL_POLYGON_OFFSET_UNITS, units);
 }
 
 void APIENTRY gl_cull_face_ovr(GLenum mode)
 {
     GLCullFaceCommand payload{ mode };
-    g_ipc.write_command(GLCommandType::GLCMD_CULL_FACE, payload);
+    if (s_elide(GLFilteredState::CULL_FACE, payload))
+    {
+        return;
+    }
+    g_context->ipc->write_command<GLCommandType::GLCMD_CULL_FACE>(payload);
+    g_context->state_mirror.set(GL_CULL_FACE_MODE, mode);
 }
 
 void APIENTRY gl_stencil_mask_ovr(GLuint mask)
 {
     GLStencilMaskCommand payload{ mask };
-    g_ipc.write_command(GLCommandType::GLCMD_STENCIL_MASK, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_STENCIL_MASK>(payload);
+    g_context->state_mirror.set(GL_STENCIL_WRITEMASK, mask);
 }
 
 void APIENTRY gl_stencil_func_ovr(GLenum func, GLint ref, GLuint mask)
 {
     GLStencilFuncCommand payload{ func, ref, mask };
-    g_ipc.write_command(GLCommandType::GLCMD_STENCIL_FUNC, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_STENCIL_FUNC>(payload);
+    g_context->state_mirror.set(GL_STENCIL_FUNC, func);
+    g_context->state_mirror.set(GL_STENCIL_REF, ref);
+    g_context->state_mirror.set(GL_STENCIL_VALUE_MASK, mask);
 }
 
 void APIENTRY gl_stencil_op_ovr(GLenum sfail, GLenum dpfail, GLenum dppass)
 {
     GLStencilOpCommand payload{ sfail, dpfail, dppass };
-    g_ipc.write_command(GLCommandType::GLCMD_STENCIL_OP, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_STENCIL_OP>(payload);
+    g_context->state_mirror.set(GL_STENCIL_FAIL, sfail);
+    g_context->state_mirror.set(GL_STENCIL_PASS_DEPTH_FAIL, dpfail);
+    g_context->state_mirror.set(GL_STENCIL_PASS_DEPTH_PASS, dppass);
 }
 
 void APIENTRY gl_stencil_op_separate_ATI_ovr(GLenum face, GLenum sfail, GLenum dpfail, GLenum dppass)
 {
     GLStencilOpSeparateATICommand payload{ face, sfail, dpfail, dppass };
-    g_ipc.write_command(GLCommandType::GLCMD_STENCIL_OP_SEPARATE_ATI, payload);
+    g_context->ipc->write_command<GLCommandType::GLCMD_STENCIL_OP_SEPARATE_ATI>(payload);
 }
 
 const GLubyte* APIENTRY gl_get_string_ovr(GLenum name)
@@ -732,27 +1135,92 @@ void APIENTRY gl_multi_tex_coord_2fv_ARB(GLenum target, const float* v)
     return;
 }
 
-void APIENTRY gl_get_integer_v(GLenum pname, GLint* data)
+/* STATE QUERIES
+ * Answered from the current context's `GLStateMirror`, never from the renderer.
+ * Untracked pnames read as 0.
+ */
+template<typename T>
+static void s_get_mirrored(GLenum pname, T* data)
 {
-    switch (pname)
+    const GLMirrorValue* value = g_context->state_mirror.find(pname);
+    if (!value)
     {
-        case GL_MAX_TEXTURE_SIZE: *data = 4096; return;
+        *data = 0;
+        return;
+    }
 
-        default: *data = 0; return;
+    for (UINT32 i = 0; i < value->count; i++)
+    {
+        if constexpr (std::is_same_v<T, GLboolean>)
+        {
+            data[i] = value->values[i] != 0.0 ? GL_TRUE : GL_FALSE;
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            data[i] = static_cast<T>(std::llround(value->values[i]));
+        }
+        else
+        {
+            data[i] = static_cast<T>(value->values[i]);
+        }
     }
 }
 
+void APIENTRY gl_get_integer_v(GLenum pname, GLint* data)
+{
+    s_get_mirrored(pname, data);
+}
+
+void APIENTRY gl_get_float_v(GLenum pname, GLfloat* data)
+{
+    s_get_mirrored(pname, data);
+}
+
+void APIENTRY gl_get_double_v(GLenum pname, GLdouble* data)
+{
+    s_get_mirrored(pname, data);
+}
+
+void APIENTRY gl_get_boolean_v(GLenum pname, GLboolean* data)
+{
+    s_get_mirrored(pname, data);
+}
+
+GLboolean APIENTRY gl_is_enabled(GLenum cap)
+{
+    const GLMirrorValue* value = g_context->state_mirror.find(cap);
+    return value && value->values[0] != 0.0 ? GL_TRUE : GL_FALSE;
+}
+
+GLboolean APIENTRY gl_is_texture(GLuint texture)
+{
+    return g_context->state_mirror.is_texture(texture) ? GL_TRUE : GL_FALSE;
+}
+
 GLenum APIENTRY gl_get_error()
 {
-    return GL_NO_ERROR;
+    // pick up errors the renderer raised since the last frame boundary, replies are the writer's
+    if (g_context->ipc->is_writer_thread())
+    {
+        g_context->state_mirror.sync(*g_context->ipc);
+    }
+    return g_context->state_mirror.take_error();
 }
 
 /* WGL (Windows Graphics Library) overrides */
 
 BOOL WINAPI swap_buffers_ovr(HDC)
 {
-    g_ipc.end_frame();
-    g_ipc.start_frame_or_wait();
+    // threads without a current context only record, the writer thread merges them at its swap
+    if (!g_context->ipc->is_writer_thread())
+    {
+        return TRUE;
+    }
+
+    report_elided_commands(*g_context);
+    g_context->ipc->end_frame();
+    g_context->ipc->start_frame_or_wait();
+    g_context->state_mirror.sync(*g_context->ipc);
 
     return TRUE;
 }
@@ -834,13 +1302,12 @@ static LRESULT CALLBACK s_input_capture_wnd_proc(HWND hwnd, UINT msg, WPARAM wpa
 
     if (should_send)
     {
-        const WGLInputEventCommand payload{
+        // out of band, so the renderer sees it before the game finishes the frame
+        g_ipc.push_event({
             .msg = msg,
             .wparam = wparam,
             .lparam = static_cast<UINT64>(lparam),
-        };
-
-        g_ipc.write_command(GLCommandType::WGLCMD_INPUT_EVENT, payload);
+        });
     }
 
     // Call the original window procedure
@@ -941,16 +1408,37 @@ HGLRC WINAPI create_context_ovr(HDC dc)
                              reinterpret_cast<LONG_PTR>(s_input_capture_wnd_proc)));
     }
 
-    WGLCreateContextCommand payload{ hwnd };
+    GLContext* context = create_context();
+    if (!context)
+    {
+        DBG_PRINT("glRemix - All %u context streams are in use.", k_IPC_MAX_STREAMS);
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return nullptr;
+    }
 
-    // TODO: Application can do multiple create/destroy context pairs, so we need to account for that
-    g_ipc.write_command(GLCommandType::WGLCMD_CREATE_CONTEXT, payload);
+    // the renderer starts the context over, on stream 0 it also (re)creates the swapchain
+    WGLCreateContextCommand payload{ reinterpret_cast<UINT_PTR>(hwnd) };
+    context->ipc->write_command<GLCommandType::WGLCMD_CREATE_CONTEXT>(payload);
 
-    return reinterpret_cast<HGLRC>(static_cast<UINT_PTR>(0xDEADBEEF));  // Dummy context handle
+    return get_context_handle(*context);
 }
 
-BOOL WINAPI delete_context_ovr(HGLRC context)
+BOOL WINAPI delete_context_ovr(HGLRC handle)
 {
+    GLContext* context = find_context(handle);
+    if (!context)
+    {
+        return FALSE;
+    }
+
+    // deleting the current context releases it first
+    if (context == g_context)
+    {
+        g_current_context = nullptr;
+        g_context = &get_default_context();
+    }
+
+    delete_context(context);
     return TRUE;
 }
 
@@ -964,15 +1452,42 @@ HDC WINAPI get_current_dc_ovr()
     return g_current_dc;
 }
 
-BOOL WINAPI make_current_ovr(HDC dc, HGLRC context)
+BOOL WINAPI make_current_ovr(HDC dc, HGLRC handle)
 {
+    GLContext* context = find_context(handle);
+    if (handle && !context)
+    {
+        return FALSE;
+    }
+
+    // like GL, a context that stops being current flushes so other contexts see its objects
+    if (context != g_context)
+    {
+        flush_context(*g_context);
+    }
+
     g_current_dc = dc;
-    g_current_context = context;
+    g_current_context = handle;
+    g_context = context ? context : &get_default_context();
+
+    // this thread records straight into the stream now, others calling in get buffered
+    if (context)
+    {
+        context->ipc->set_writer_thread();
+    }
     return TRUE;
 }
 
-BOOL WINAPI share_lists_ovr(HGLRC, HGLRC)
+BOOL WINAPI share_lists_ovr(HGLRC source, HGLRC target)
 {
+    const GLContext* source_context = find_context(source);
+    const GLContext* target_context = find_context(target);
+    if (!source_context || !target_context)
+    {
+        return FALSE;
+    }
+
+    share_lists(*source_context, *target_context);
     return TRUE;
 }
 
@@ -1030,6 +1545,8 @@ void install_overrides()
         gl::register_hook("glDrawElements", reinterpret_cast<PROC>(&gl_draw_elements_ovr));
         gl::register_hook("glDrawRangeElements",
                           reinterpret_cast<PROC>(&gl_draw_range_elements_ovr));
+        gl::register_hook("glLockArraysEXT", reinterpret_cast<PROC>(&gl_lock_arrays_EXT_ovr));
+        gl::register_hook("glUnlockArraysEXT", reinterpret_cast<PROC>(&gl_unlock_arrays_EXT_ovr));
 
         /* MATRIX OPERATIONS */
         gl::register_hook("glMatrixMode", reinterpret_cast<PROC>(&gl_matrix_mode_ovr));
@@ -1085,6 +1602,11 @@ void install_overrides()
         /* MISC */
         gl::register_hook("glGetString", reinterpret_cast<PROC>(&gl_get_string_ovr));
         gl::register_hook("glGetIntegerv", reinterpret_cast<PROC>(&gl_get_integer_v));
+        gl::register_hook("glGetFloatv", reinterpret_cast<PROC>(&gl_get_float_v));
+        gl::register_hook("glGetDoublev", reinterpret_cast<PROC>(&gl_get_double_v));
+        gl::register_hook("glGetBooleanv", reinterpret_cast<PROC>(&gl_get_boolean_v));
+        gl::register_hook("glIsEnabled", reinterpret_cast<PROC>(&gl_is_enabled));
+        gl::register_hook("glIsTexture", reinterpret_cast<PROC>(&gl_is_texture));
         gl::register_hook("glGetError", reinterpret_cast<PROC>(&gl_get_error));
         gl::register_hook("glActiveTextureARB", reinterpret_cast<PROC>(&gl_active_texture_ARB));
         gl::register_hook("glClientActiveTexture",
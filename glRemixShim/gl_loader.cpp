@@ -16,8 +16,43 @@ std::mutex g_hook_mutex;
 // Function pointers for our custom hook implementations
 tsl::robin_map<std::string, PROC> g_hooks;
 
+std::array<std::atomic<PROC>, k_NUM_HOOKS> g_hook_table{};
+
+// Maps an exported function name to its slot in `g_hook_table`, names without a wrapper are absent
+static const tsl::robin_map<std::string, HookId>& s_hook_ids()
+{
+    static const tsl::robin_map<std::string, HookId> hook_ids = []
+    {
+        tsl::robin_map<std::string, HookId> ids;
+        ids.reserve(k_NUM_HOOKS);
+#define GLREMIX_HOOK(name) ids.emplace(#name, HookId::name);
+#include "gl_hook_list.inl"
+#include "wgl_hook_list.inl"
+#undef GLREMIX_HOOK
+        return ids;
+    }();
+    return hook_ids;
+}
+
 HANDLE g_renderer_process = nullptr;
 
+// every stream maps its regions the same way
+static void s_configure_mapping(IPCProtocol& ipc)
+{
+    IPCMapOptions map_options;
+#ifdef GLREMIX_IPC_PREFAULT
+    map_options.prefault = true;
+#endif
+#ifdef GLREMIX_IPC_LARGE_PAGES
+    map_options.large_pages = true;
+#endif
+    ipc.set_map_options(map_options);
+#if defined(GLREMIX_IPC_BULK_WINDOW_MB) && !defined(_WIN64)
+    // 64-bit games have address space to spare, only 32-bit ones walk the arena
+    ipc.set_bulk_window(static_cast<UINT32>(GLREMIX_IPC_BULK_WINDOW_MB * MEGABYTE));
+#endif
+}
+
 std::once_flag g_initialize_flag;
 
 void initialize()
@@ -25,8 +60,16 @@ void initialize()
     // create lambda function for `std::call_once`
     auto initialize_once_fn = []
     {
+#ifdef GLREMIX_FRAME_POLICY
+        g_ipc.set_frame_policy(IPCFramePolicy::GLREMIX_FRAME_POLICY, GLREMIX_FRAME_QUEUE_DEPTH);
+#endif
+        s_configure_mapping(g_ipc);
         g_ipc.init_writer();  // initialize shim as IPC writer
         g_ipc.start_frame_or_wait();
+#ifdef GLREMIX_IPC_PUBLISHER_THREAD
+        // the game thread only records, copying into the ring and pacing happen on this thread
+        g_ipc.start_publisher();
+#endif
 
 #ifdef GLREMIX_AUTO_LAUNCH_RENDERER
         // Start the renderer as a subprocess
@@ -77,6 +120,23 @@ void initialize()
     std::call_once(g_initialize_flag, initialize_once_fn);
 }
 
+std::unique_ptr<IPCProtocol> create_stream(const UINT32 stream)
+{
+    auto ipc = std::make_unique<IPCProtocol>();
+    ipc->set_stream(stream, &g_ipc);
+    s_configure_mapping(*ipc);
+
+    // only stream 0 paces the game, the others are flushed whenever the game likes
+    ipc->set_frame_policy(IPCFramePolicy::FIFO, k_IPC_MAX_QUEUE_DEPTH);
+
+    ipc->init_writer();
+    ipc->start_frame_or_wait();
+
+    // the renderer opens the stream as soon as it shows up here
+    g_ipc.open_stream(stream);
+    return ipc;
+}
+
 void register_hook(const char* name, const PROC proc)
 {
     if (name == nullptr)
@@ -85,6 +145,13 @@ void register_hook(const char* name, const PROC proc)
     }
 
     std::scoped_lock lock(g_hook_mutex);
+
+    const auto& hook_ids = s_hook_ids();
+    if (const auto it = hook_ids.find(name); it != hook_ids.end())
+    {
+        g_hook_table[static_cast<size_t>(it->second)].store(proc, std::memory_order_relaxed);
+    }
+
     if (proc == nullptr)
     {
         g_hooks.erase(name);
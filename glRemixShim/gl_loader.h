@@ -2,6 +2,10 @@
 
 #include <shared/ipc_protocol.h>
 
+#include <array>
+#include <atomic>
+#include <memory>
+
 #include "framework.h"
 
 namespace glRemix
@@ -18,16 +22,41 @@ static const char g_extensions[] =
 
 namespace gl
 {
+// Dense index for every exported wrapper, generated alongside the wrappers themselves
+enum class HookId : UINT32
+{
+#define GLREMIX_HOOK(name) name,
+#include "gl_hook_list.inl"
+#include "wgl_hook_list.inl"
+#undef GLREMIX_HOOK
+    _COUNT,
+};
+
+constexpr size_t k_NUM_HOOKS = static_cast<size_t>(HookId::_COUNT);
+
+// Filled by `register_hook` during `install_overrides`, read by exported wrappers on every call
+extern std::array<std::atomic<PROC>, k_NUM_HOOKS> g_hook_table;
+
 extern HANDLE g_renderer_process;
 
 void initialize();
 
+// Writer for a secondary GL context's stream, mapped like `g_ipc` and listed in its directory
+std::unique_ptr<IPCProtocol> create_stream(UINT32 stream);
+
 // Add function pointer to hooks map using name as key
 void register_hook(const char* name, PROC proc);
 
 // Try to return hooked function pointer using name as hook map lookup
+// Slow path, only used by `wglGetProcAddress`
 PROC find_hook(const char* name);
 
+// Hot path for exported wrappers, hook pointers never point to unpublished data so relaxed is fine
+inline PROC load_hook(const HookId id)
+{
+    return g_hook_table[static_cast<size_t>(id)].load(std::memory_order_relaxed);
+}
+
 // Print out missing function name to debug output
 void report_missing_function(const char* name);
 }  // namespace gl
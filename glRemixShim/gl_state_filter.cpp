@@ -0,0 +1,84 @@
+#include "gl_state_filter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace glRemix::hooks
+{
+// capabilities games toggle every draw, the others always go through
+constexpr GLenum k_FILTERED_CAPS[] = {
+    GL_TEXTURE_2D,   GL_LIGHTING,          GL_BLEND,  GL_DEPTH_TEST,     GL_CULL_FACE,
+    GL_ALPHA_TEST,   GL_FOG,               GL_DITHER, GL_COLOR_MATERIAL, GL_NORMALIZE,
+    GL_STENCIL_TEST, GL_SCISSOR_TEST,      GL_LIGHT0, GL_LIGHT1,         GL_LIGHT2,
+    GL_LIGHT3,       GL_LIGHT4,            GL_LIGHT5, GL_LIGHT6,         GL_LIGHT7,
+    GL_POLYGON_OFFSET_FILL,
+};
+static_assert(std::size(k_FILTERED_CAPS) <= 32);
+
+bool GLStateFilter::elide_cap(const GLenum cap, const bool enabled, const UINT32 record_bytes)
+{
+    const auto* it = std::find(std::begin(k_FILTERED_CAPS), std::end(k_FILTERED_CAPS), cap);
+    if (it == std::end(k_FILTERED_CAPS))
+    {
+        return false;
+    }
+
+    const UINT32 bit = 1u << static_cast<UINT32>(it - std::begin(k_FILTERED_CAPS));
+    if ((m_caps_known & bit) && ((m_caps_enabled & bit) != 0) == enabled)
+    {
+        count_elided(record_bytes);
+        return true;
+    }
+
+    m_caps_known |= bit;
+    m_caps_enabled = enabled ? m_caps_enabled | bit : m_caps_enabled & ~bit;
+    return false;
+}
+
+void GLStateFilter::forget(const GLFilteredState state)
+{
+    m_known &= ~(1u << static_cast<UINT32>(state));
+}
+
+void GLStateFilter::forget_all()
+{
+    m_known = 0;
+    m_caps_known = 0;
+}
+
+UINT32 GLStateFilter::take_elided_commands()
+{
+    return std::exchange(m_elided_commands, 0);
+}
+
+UINT32 GLStateFilter::take_elided_bytes()
+{
+    return std::exchange(m_elided_bytes, 0);
+}
+
+bool GLStateFilter::elide(const GLFilteredState state, const void* value, const UINT32 value_bytes,
+                          const UINT32 record_bytes)
+{
+    const UINT32 bit = 1u << static_cast<UINT32>(state);
+    Slot& slot = m_values[static_cast<UINT32>(state)];
+
+    // bitwise, so -0.0f vs 0.0f just isn't elided
+    if ((m_known & bit) && memcmp(slot.data(), value, value_bytes) == 0)
+    {
+        count_elided(record_bytes);
+        return true;
+    }
+
+    memcpy(slot.data(), value, value_bytes);
+    m_known |= bit;
+    return false;
+}
+
+void GLStateFilter::count_elided(const UINT32 record_bytes)
+{
+    m_elided_commands++;
+    m_elided_bytes += record_bytes;
+}
+}  // namespace glRemix::hooks
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <shared/ipc_protocol.h>
+
+#include <framework.h>
+#include <GL/gl.h>
+
+#include <array>
+
+namespace glRemix::hooks
+{
+// current values the filter compares against, one slot each
+enum class GLFilteredState : UINT32
+{
+    COLOR,            // GLVec4f, `glColor3f` sets alpha to 1
+    NORMAL,           // GLVec3f
+    TEXTURE_BINDING,  // GL_TEXTURE_2D only
+    MATRIX_MODE,
+    BLEND_FUNC,
+    DEPTH_MASK,
+    ALPHA_FUNC,
+    CULL_FACE,
+    _COUNT
+};
+
+/*
+ * Shadow of the renderer state the state hooks set, used to drop calls that change nothing.
+ * Every slot starts out unknown, so the first call always goes through. Anything the shim can't
+ * follow (display lists, vertex batches) makes the affected slots unknown again.
+ * The hooks bypass it while a display list is compiled, lists have to keep every command.
+ */
+class GLStateFilter
+{
+public:
+    // true when `value` is already current and the command can be dropped, else stores it
+    template<typename T>
+    bool elide(const GLFilteredState state, const T& value, const UINT32 record_bytes)
+    {
+        static_assert(sizeof(T) <= sizeof(Slot));
+        return elide(state, &value, sizeof(T), record_bytes);
+    }
+
+    bool elide_cap(GLenum cap, bool enabled, UINT32 record_bytes);
+
+    void forget(GLFilteredState state);
+    void forget_all();  // after `glCallList` or a list compiled with GL_COMPILE_AND_EXECUTE
+
+    // elided since the last call, reported once per frame
+    UINT32 take_elided_commands();
+    UINT32 take_elided_bytes();
+
+private:
+    using Slot = std::array<UINT32, 4>;
+
+    std::array<Slot, static_cast<UINT32>(GLFilteredState::_COUNT)> m_values{};
+    UINT32 m_known = 0;  // bit per `GLFilteredState`
+
+    // bit per entry of `k_FILTERED_CAPS`
+    UINT32 m_caps_known = 0;
+    UINT32 m_caps_enabled = 0;
+
+    UINT32 m_elided_commands = 0;
+    UINT32 m_elided_bytes = 0;
+
+    bool elide(GLFilteredState state, const void* value, UINT32 value_bytes, UINT32 record_bytes);
+    void count_elided(UINT32 record_bytes);
+};
+}  // namespace glRemix::hooks
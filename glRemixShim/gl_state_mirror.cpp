@@ -0,0 +1,126 @@
+#include "gl_state_mirror.h"
+
+namespace glRemix::hooks
+{
+// initial values from the gl 1.x spec state tables, limits until the renderer reports its own
+GLStateMirror::GLStateMirror()
+{
+    set(GL_MATRIX_MODE, GL_MODELVIEW);
+    set(GL_COLOR_CLEAR_VALUE, 0.0, 0.0, 0.0, 0.0);
+    set(GL_COLOR_WRITEMASK, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    set(GL_DEPTH_WRITEMASK, GL_TRUE);
+    set(GL_BLEND_SRC, GL_ONE);
+    set(GL_BLEND_DST, GL_ZERO);
+    set(GL_POINT_SIZE, 1.0);
+    set(GL_CULL_FACE_MODE, GL_BACK);
+    set(GL_ALPHA_TEST_FUNC, GL_ALWAYS);
+    set(GL_ALPHA_TEST_REF, 0.0);
+    set(GL_STENCIL_WRITEMASK, 0xFFFFFFFF);
+    set(GL_STENCIL_FUNC, GL_ALWAYS);
+    set(GL_STENCIL_REF, 0);
+    set(GL_STENCIL_VALUE_MASK, 0xFFFFFFFF);
+    set(GL_STENCIL_FAIL, GL_KEEP);
+    set(GL_STENCIL_PASS_DEPTH_FAIL, GL_KEEP);
+    set(GL_STENCIL_PASS_DEPTH_PASS, GL_KEEP);
+    set(GL_POLYGON_OFFSET_FACTOR, 0.0);
+    set(GL_POLYGON_OFFSET_UNITS, 0.0);
+    set(GL_TEXTURE_BINDING_2D, 0);
+    set(GL_LIST_INDEX, 0);
+    set(GL_LIST_MODE, 0);
+    set(GL_DITHER, GL_TRUE);  // the only capability enabled initially
+
+    set(GL_MAX_TEXTURE_SIZE, 4096);
+    set(GL_MAX_VIEWPORT_DIMS, 4096, 4096);
+    set(GL_MAX_LIGHTS, 8);
+    set(GL_MAX_CLIP_PLANES, 6);
+    set(GL_MAX_LIST_NESTING, 64);
+    set(GL_MAX_MODELVIEW_STACK_DEPTH, 32);
+    set(GL_MAX_PROJECTION_STACK_DEPTH, 2);
+    set(GL_MAX_TEXTURE_STACK_DEPTH, 2);
+    set(GL_MAX_ATTRIB_STACK_DEPTH, 16);
+}
+
+void GLStateMirror::sync(IPCProtocol& ipc)
+{
+    IPCReply reply;
+    while (ipc.pop_reply(&reply))
+    {
+        switch (reply.type)
+        {
+            case IPCReplyType::GL_ERROR: set_error(static_cast<GLenum>(reply.value)); break;
+            case IPCReplyType::INTEGER: set(reply.name, reply.value); break;
+            case IPCReplyType::TEXTURE_INVALID: m_textures.erase(reply.name); break;
+            default: break;
+        }
+    }
+}
+
+void GLStateMirror::set(const GLenum pname, const GLdouble v0)
+{
+    GLMirrorValue& value = m_values[pname];
+    value.values[0] = v0;
+    value.count = 1;
+}
+
+void GLStateMirror::set(const GLenum pname, const GLdouble v0, const GLdouble v1)
+{
+    GLMirrorValue& value = m_values[pname];
+    value.values = { v0, v1 };
+    value.count = 2;
+}
+
+void GLStateMirror::set(const GLenum pname, const GLdouble v0, const GLdouble v1,
+                        const GLdouble v2, const GLdouble v3)
+{
+    GLMirrorValue& value = m_values[pname];
+    value.values = { v0, v1, v2, v3 };
+    value.count = 4;
+}
+
+const GLMirrorValue* GLStateMirror::find(const GLenum pname) const
+{
+    const auto it = m_values.find(pname);
+    return it != m_values.end() ? &it->second : nullptr;
+}
+
+void GLStateMirror::set_error(const GLenum error)
+{
+    if (m_error == GL_NO_ERROR)
+    {
+        m_error = error;
+    }
+}
+
+GLenum GLStateMirror::take_error()
+{
+    const GLenum error = m_error;
+    m_error = GL_NO_ERROR;
+    return error;
+}
+
+void GLStateMirror::bind_texture(const GLuint texture)
+{
+    set(GL_TEXTURE_BINDING_2D, texture);
+    if (texture != 0)
+    {
+        m_textures.insert(texture);
+    }
+}
+
+void GLStateMirror::delete_texture(const GLuint texture)
+{
+    m_textures.erase(texture);
+
+    // deleting the bound texture reverts the binding to the default one
+    const GLMirrorValue* bound = find(GL_TEXTURE_BINDING_2D);
+    if (bound && bound->values[0] == texture)
+    {
+        set(GL_TEXTURE_BINDING_2D, 0);
+    }
+}
+
+bool GLStateMirror::is_texture(const GLuint texture) const
+{
+    return m_textures.contains(texture);
+}
+}  // namespace glRemix::hooks
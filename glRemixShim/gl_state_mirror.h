@@ -0,0 +1,58 @@
+#pragma once
+
+#include <tsl/robin_map.h>
+#include <tsl/robin_set.h>
+
+#include <shared/ipc_protocol.h>
+
+#include <framework.h>
+#include <GL/gl.h>
+
+#include <array>
+
+namespace glRemix::hooks
+{
+// values of one `glGet` pname, doubles hold every GLint / GLuint / GLfloat exactly
+struct GLMirrorValue
+{
+    std::array<GLdouble, 4> values{};
+    UINT32 count = 0;
+};
+
+/*
+ * Game-side copy of the GL state the renderer owns, so `glGet*`, `glIsEnabled`, `glIsTexture` and
+ * `glGetError` are answered locally instead of waiting on a round trip through the ring.
+ * Hooks record what the game set; the renderer corrects the copy asynchronously through
+ * `IPCProtocol` replies (errors it raised, its real limits, textures it could not create).
+ */
+class GLStateMirror
+{
+public:
+    GLStateMirror();
+
+    // drains pending renderer replies, a single atomic load when there are none
+    void sync(IPCProtocol& ipc);
+
+    // as many values as the pname's query returns, `glGet*` writes exactly that many
+    void set(GLenum pname, GLdouble v0);
+    void set(GLenum pname, GLdouble v0, GLdouble v1);
+    void set(GLenum pname, GLdouble v0, GLdouble v1, GLdouble v2, GLdouble v3);
+
+    // nullptr for pnames the mirror doesn't track
+    const GLMirrorValue* find(GLenum pname) const;
+
+    // GL keeps the first error until it is queried
+    void set_error(GLenum error);
+    GLenum take_error();
+
+    // names become textures once bound, like in GL
+    void bind_texture(GLuint texture);
+    void delete_texture(GLuint texture);
+    bool is_texture(GLuint texture) const;
+
+private:
+    tsl::robin_map<GLenum, GLMirrorValue> m_values;
+    tsl::robin_set<GLuint> m_textures;
+    GLenum m_error = GL_NO_ERROR;
+};
+}  // namespace glRemix::hooks
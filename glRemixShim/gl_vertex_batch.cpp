@@ -0,0 +1,106 @@
+#include "gl_vertex_batch.h"
+
+#include <algorithm>
+
+namespace glRemix::hooks
+{
+// Payload bytes of `values`, the record header counts them as 32-bit
+template<typename T>
+static UINT32 s_array_bytes(const std::vector<T>& values)
+{
+    return static_cast<UINT32>(values.size() * sizeof(T));
+}
+
+template<typename T>
+static void s_write_array(IPCProtocol& ipc, const std::vector<T>& values)
+{
+    if (!values.empty())
+    {
+        ipc.write_simple(values.data(), s_array_bytes(values));
+    }
+}
+
+void GLVertexBatch::begin(const GLenum mode)
+{
+    m_recording = true;
+    m_mode = mode;
+    m_attributes = 0;
+
+    m_positions.clear();
+    m_colors.clear();
+    m_normals.clear();
+    m_uvs.clear();
+}
+
+void GLVertexBatch::end(IPCProtocol& ipc)
+{
+    m_recording = false;
+
+    GLRemixVertexBatchCommand payload{ .mode = m_mode,
+                                       .count = static_cast<UINT32>(m_positions.size()),
+                                       .attributes = m_attributes,
+                                       .first = {},
+                                       .color = m_color,
+                                       .normal = m_normal,
+                                       .uv = m_uv };
+    std::copy(m_first.begin(), m_first.end(), payload.first);
+
+    // only the arrays of attributes set in the batch are filled, the others are empty
+    const UINT32 extra_data_bytes = s_array_bytes(m_positions) + s_array_bytes(m_colors)
+                                    + s_array_bytes(m_normals) + s_array_bytes(m_uvs);
+
+    ipc.write_command<GLCommandType::GLREMIXCMD_VERTEX_BATCH>(payload, extra_data_bytes, false,
+                                                              nullptr);
+    s_write_array(ipc, m_positions);
+    s_write_array(ipc, m_colors);
+    s_write_array(ipc, m_normals);
+    s_write_array(ipc, m_uvs);
+}
+
+void GLVertexBatch::vertex(const GLVec3f& position)
+{
+    m_positions.push_back(position);
+
+    if (m_attributes & 1u << static_cast<UINT32>(GLRemixVertexAttribute::COLOR))
+    {
+        m_colors.push_back(m_color);
+    }
+    if (m_attributes & 1u << static_cast<UINT32>(GLRemixVertexAttribute::NORMAL))
+    {
+        m_normals.push_back(m_normal);
+    }
+    if (m_attributes & 1u << static_cast<UINT32>(GLRemixVertexAttribute::TEXCOORD))
+    {
+        m_uvs.push_back(m_uv);
+    }
+}
+
+void GLVertexBatch::color(const GLVec4f& color)
+{
+    set_attribute(GLRemixVertexAttribute::COLOR);
+    m_color = color;
+}
+
+void GLVertexBatch::normal(const GLVec3f& normal)
+{
+    set_attribute(GLRemixVertexAttribute::NORMAL);
+    m_normal = normal;
+}
+
+void GLVertexBatch::tex_coord(const GLVec2f& uv)
+{
+    set_attribute(GLRemixVertexAttribute::TEXCOORD);
+    m_uv = uv;
+}
+
+// Vertices recorded before an attribute was first set keep the renderer's current value
+void GLVertexBatch::set_attribute(const GLRemixVertexAttribute attribute)
+{
+    const UINT32 bit = 1u << static_cast<UINT32>(attribute);
+    if (!(m_attributes & bit))
+    {
+        m_attributes |= bit;
+        m_first[static_cast<UINT32>(attribute)] = static_cast<UINT32>(m_positions.size());
+    }
+}
+}  // namespace glRemix::hooks
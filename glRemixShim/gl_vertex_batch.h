@@ -0,0 +1,55 @@
+#pragma once
+
+#include <shared/ipc_protocol.h>
+
+#include <framework.h>
+#include <GL/gl.h>
+
+#include <array>
+#include <vector>
+
+namespace glRemix::hooks
+{
+/*
+ * Collects the calls between `glBegin` and `glEnd` into SoA arrays and records them as a single
+ * `GLREMIXCMD_VERTEX_BATCH` at `glEnd`. Attributes never set inside the batch aren't sent, the
+ * renderer uses its current value for them, so a plain run of `glVertex3f` costs 12 bytes per
+ * vertex instead of a 20 byte record.
+ */
+class GLVertexBatch
+{
+public:
+    void begin(GLenum mode);
+    void end(IPCProtocol& ipc);
+
+    inline bool is_recording() const
+    {
+        return m_recording;
+    }
+
+    void vertex(const GLVec3f& position);
+    void color(const GLVec4f& color);
+    void normal(const GLVec3f& normal);
+    void tex_coord(const GLVec2f& uv);
+
+private:
+    bool m_recording = false;
+    UINT32 m_mode = 0;
+
+    UINT32 m_attributes = 0;  // bit per `GLRemixVertexAttribute` set since `begin`
+    std::array<UINT32, static_cast<UINT32>(GLRemixVertexAttribute::_COUNT)> m_first{};
+
+    // last values set, every later vertex takes them
+    GLVec4f m_color{};
+    GLVec3f m_normal{};
+    GLVec2f m_uv{};
+
+    // kept across batches so steady state recording doesn't allocate
+    std::vector<GLVec3f> m_positions;
+    std::vector<GLVec4f> m_colors;
+    std::vector<GLVec3f> m_normals;
+    std::vector<GLVec2f> m_uvs;
+
+    void set_attribute(GLRemixVertexAttribute attribute);
+};
+}  // namespace glRemix::hooks
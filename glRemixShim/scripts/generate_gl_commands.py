@@ -0,0 +1,178 @@
+"""Generate the IPC command enum, payload layouts and renderer dispatch from gl_commands.schema."""
+
+import argparse
+from dataclasses import dataclass
+from pathlib import Path
+from typing import List, Optional
+
+HEADER = "// Auto-generated from shared/gl_commands.schema. Do not edit manually."
+
+LAYOUTS = {"fixed", "trailing"}
+
+
+@dataclass
+class Command:
+    section: Optional[str]  # set on the first command of a section
+    type: str
+    payload: Optional[str]  # None for IPC markers
+    layout: str
+    handler: Optional[str]  # None when the renderer ignores the command
+    comment: str
+
+    @property
+    def is_marker(self) -> bool:
+        return self.payload is None
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("-s", "--schema", type=Path, required=True, help="Path to gl_commands.schema")
+    parser.add_argument("-t", "--types-output", type=Path, required=True, help="Path to write the GLCommandType entries")
+    parser.add_argument("-l", "--layouts-output", type=Path, required=True, help="Path to write the payload traits and layouts")
+    parser.add_argument("-d", "--dispatch-output", type=Path, required=True, help="Path to write the renderer's dispatch switch")
+    return parser.parse_args()
+
+
+def parse_schema(path: Path) -> List[Command]:
+    commands: List[Command] = []
+    section: Optional[str] = None
+    seen = set()
+
+    for number, raw in enumerate(path.read_text(encoding="utf-8").splitlines(), start=1):
+        line, _, comment = raw.partition("#")
+        line = line.strip()
+        if not line:
+            continue
+
+        if line.startswith("[") and line.endswith("]"):
+            section = line[1:-1]
+            continue
+
+        fields = line.split()
+        if len(fields) != 4:
+            raise RuntimeError(f"{path}:{number}: expected <type> <payload> <layout> <handler>")
+
+        type_name, payload, layout, handler = fields
+        if type_name in seen:
+            raise RuntimeError(f"{path}:{number}: {type_name} is listed twice")
+        if layout not in LAYOUTS:
+            raise RuntimeError(f"{path}:{number}: unknown layout '{layout}'")
+        if (payload == "-") != (handler == "ipc"):
+            raise RuntimeError(f"{path}:{number}: only IPC markers go without a payload")
+        seen.add(type_name)
+
+        commands.append(Command(
+            section=section,
+            type=type_name,
+            payload=None if payload == "-" else payload,
+            layout=layout,
+            handler=None if handler in ("-", "ipc") else handler,
+            comment=comment.strip(),
+        ))
+        section = None
+
+    if not commands:
+        raise RuntimeError(f"{path}: no commands")
+    return commands
+
+
+def write_text(path: Path, lines: List[str]) -> None:
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_text("\n".join(lines) + "\n", encoding="utf-8")
+
+
+def generate_types(commands: List[Command]) -> List[str]:
+    # 0 is never a valid command, so a zeroed record is caught
+    lines = [HEADER]
+    for index, command in enumerate(commands):
+        if command.section:
+            if index > 0:
+                lines.append("")
+            lines.append(f"// {command.section}")
+        value = " = 1" if index == 0 else ""
+        comment = f"  // {command.comment}" if command.comment else ""
+        lines.append(f"{command.type}{value},{comment}")
+    return lines
+
+
+def generate_layouts(commands: List[Command]) -> List[str]:
+    lines = [HEADER, ""]
+
+    for command in commands:
+        if command.is_marker:
+            continue
+        trailing = "true" if command.layout == "trailing" else "false"
+        lines += [
+            "template<>",
+            f"struct GLCommandTraits<GLCommandType::{command.type}>",
+            "{",
+            f"    using Payload = {command.payload};",
+            f"    static constexpr bool k_TRAILING_DATA = {trailing};",
+            "};",
+            "",
+        ]
+
+    lines.append("inline constexpr GLCommandLayout k_GLCMD_LAYOUTS[] = {")
+    lines.append("    { 0, GLPayloadLayout::NONE },  // 0 is no command")
+    for command in commands:
+        if command.is_marker:
+            entry = "{ 0, GLPayloadLayout::IPC_MARKER }"
+        else:
+            kind = "TRAILING" if command.layout == "trailing" else "FIXED"
+            entry = f"{{ sizeof({command.payload}), GLPayloadLayout::{kind} }}"
+        lines.append(f"    {entry},  // {command.type}")
+    lines.append("};")
+    lines.append("")
+    lines.append("static_assert(std::size(k_GLCMD_LAYOUTS) == static_cast<size_t>(GLCommandType::_COUNT));")
+    return lines
+
+
+def generate_dispatch(commands: List[Command]) -> List[str]:
+    lines = [
+        HEADER,
+        "// Calls the handler of every command the renderer implements, the switch covers every type.",
+        "static void dispatch_command(const GLCommandContext& ctx, const GLCommandType type,",
+        "                             const void* data)",
+        "{",
+        "    switch (type)",
+        "    {",
+    ]
+
+    for command in commands:
+        if command.handler:
+            lines += [
+                f"        case GLCommandType::{command.type}:",
+                f"            handle_{command.handler}(ctx, static_cast<const {command.payload}*>(data));",
+                "            break;",
+            ]
+
+    lines.append("")
+    lines.append("        // decoded, but nothing the renderer uses")
+    for command in commands:
+        if not command.handler and not command.is_marker:
+            lines.append(f"        case GLCommandType::{command.type}:")
+    lines.append("            break;")
+
+    lines.append("")
+    lines.append("        // consumed by `IPCProtocol`, `glDriver::read_next_command` rejects them")
+    for command in commands:
+        if command.is_marker:
+            lines.append(f"        case GLCommandType::{command.type}:")
+    lines.append("        case GLCommandType::_COUNT: break;")
+
+    lines += [
+        "    }",
+        "}",
+    ]
+    return lines
+
+
+def generate_commands(args: argparse.Namespace) -> None:
+    commands = parse_schema(args.schema)
+    write_text(args.types_output, generate_types(commands))
+    write_text(args.layouts_output, generate_layouts(commands))
+    write_text(args.dispatch_output, generate_dispatch(commands))
+
+
+if __name__ == "__main__":
+    generate_commands(parse_args())
@@ -16,6 +16,11 @@ def parse_args() -> argparse.Namespace:
         type=Path,
         help="Optional path to write linker alias helper macros for the exported functions",
     )
+    parser.add_argument(
+        "-l", "--hook-list-output",
+        type=Path,
+        help="Optional path to write the GLREMIX_HOOK list used to index the hook dispatch table",
+    )
     parser.add_argument(
         "-m", "--min-version",
         default="1.0",
@@ -305,6 +310,16 @@ def generate_wrappers(args: argparse.Namespace) -> None:
         args.alias_output.parent.mkdir(parents=True, exist_ok=True)
         args.alias_output.write_text(alias_text, encoding="utf-8")
 
+    if args.hook_list_output:
+        # One entry per exported wrapper, the order defines `glRemix::gl::HookId`
+        hook_lines: List[str] = [header.strip()] + [
+            f"GLREMIX_HOOK({signature['name']})" for signature in signatures
+        ]
+
+        hook_text = "\n".join(hook_lines) + "\n"
+        args.hook_list_output.parent.mkdir(parents=True, exist_ok=True)
+        args.hook_list_output.write_text(hook_text, encoding="utf-8")
+
 
 if __name__ == "__main__":
     generate_wrappers(parse_args())
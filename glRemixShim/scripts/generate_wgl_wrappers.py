@@ -39,16 +39,21 @@ WGL_FUNCTIONS = [
 def parse_args() -> argparse.Namespace:
     parser = argparse.ArgumentParser(description=__doc__)
     parser.add_argument("-o", "--output", type=Path, required=True, help="Path to write the generated wrappers .inl file")
+    parser.add_argument("-l", "--hook-list-output", type=Path, help="Optional path to write the GLREMIX_HOOK list used to index the hook dispatch table")
     return parser.parse_args()
 
 
+def exported_functions():
+    # wglGetProcAddress is implemented by hand in wgl_exports.cpp
+    return [entry for entry in WGL_FUNCTIONS if entry[1] != "wglGetProcAddress"]
+
+
 def generate_wrappers(output_path: Path) -> None:
     wrapper_lines = [
         "// Auto-generated. Do not edit manually.",
     ] + [
         f"GLREMIX_WGL_RETURN_WRAPPER({ret_type}, {name}, {f'({params})' if params else '()'}, {f'({args})' if args else '()'}, {default_val});"
-        for ret_type, name, params, args, default_val in WGL_FUNCTIONS
-        if name != "wglGetProcAddress"
+        for ret_type, name, params, args, default_val in exported_functions()
     ]
     
     output_path.parent.mkdir(parents=True, exist_ok=True)
@@ -56,6 +61,18 @@ def generate_wrappers(output_path: Path) -> None:
     print(f"Generated {output_path}")
 
 
+def generate_hook_list(output_path: Path) -> None:
+    hook_lines = [
+        "// Auto-generated. Do not edit manually.",
+    ] + [f"GLREMIX_HOOK({name})" for _, name, _, _, _ in exported_functions()]
+
+    output_path.parent.mkdir(parents=True, exist_ok=True)
+    output_path.write_text("\n".join(hook_lines) + "\n", encoding="utf-8")
+    print(f"Generated {output_path}")
+
+
 if __name__ == "__main__":
     args = parse_args()
     generate_wrappers(args.output)
+    if args.hook_list_output:
+        generate_hook_list(args.hook_list_output)
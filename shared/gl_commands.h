@@ -3,7 +3,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 
 namespace glRemix
 {
@@ -11,87 +13,13 @@ namespace glRemix
 /* ENUMS */
 enum class GLCommandType : UINT32
 {
-    // Core Immediate Mode
-    GLCMD_BEGIN = 1,
-    GLCMD_END,
-    GLCMD_VERTEX2F,
-    GLCMD_VERTEX3F,
-    GLCMD_COLOR3F,
-    GLCMD_COLOR4F,
-    GLCMD_NORMAL3F,
-    GLCMD_TEXCOORD2F,
-
-    // Display Lists
-    GLCMD_CALL_LIST,
-    GLCMD_NEW_LIST,
-    GLCMD_END_LIST,
-
-    // Client State
-    GLREMIXCMD_DRAW_ARRAYS,
-    GLREMIXCMD_DRAW_ELEMENTS,
-    GLREMIXCMD_DRAW_RANGE_ELEMENTS,
-
-    // Matrix Operations
-    GLCMD_MATRIX_MODE,
-    GLCMD_LOAD_IDENTITY,
-    GLCMD_LOAD_MATRIX,
-    GLCMD_MULT_MATRIX,
-    GLCMD_PUSH_MATRIX,
-    GLCMD_POP_MATRIX,
-    GLCMD_TRANSLATE,
-    GLCMD_ROTATE,
-    GLCMD_SCALE,
-    GLCMD_VIEWPORT,
-    GLCMD_ORTHO,
-    GLCMD_FRUSTUM,
-    GLCMD_PERSPECTIVE,
-
-    // Rendering
-    GLCMD_CLEAR,
-    GLCMD_CLEAR_COLOR,
-    GLCMD_FLUSH,
-    GLCMD_FINISH,
-    GLCMD_BIND_TEXTURE,
-    GLCMD_GEN_TEXTURES,
-    GLCMD_DELETE_TEXTURES,
-    GLCMD_TEX_IMAGE_2D,
-    GLCMD_TEX_PARAMETER,
-    GLCMD_TEX_ENV_I,
-    GLCMD_TEX_ENV_F,
-
-    // Fixed Function
-    GLCMD_LIGHTF,
-    GLCMD_LIGHTFV,
-    GLCMD_MATERIALI,
-    GLCMD_MATERIALF,
-    GLCMD_MATERIALIV,
-    GLCMD_MATERIALFV,
-    GLCMD_ALPHA_FUNC,
-
-    // State Management
-    GLCMD_ENABLE,
-    GLCMD_DISABLE,
-    GLCMD_COLOR_MASK,
-    GLCMD_DEPTH_MASK,
-    GLCMD_BLEND_FUNC,
-    GLCMD_POINT_SIZE,
-    GLCMD_POLYGON_OFFSET,
-    GLCMD_CULL_FACE,
-    GLCMD_STENCIL_MASK,
-    GLCMD_STENCIL_FUNC,
-    GLCMD_STENCIL_OP,
-    GLCMD_STENCIL_OP_SEPARATE_ATI,
-
-    // Other
-    WGLCMD_CREATE_CONTEXT,  // wglCreateContext needs IPC
-
-    // Input Events
-    WGLCMD_INPUT_EVENT,
+    // generated from gl_commands.schema, wire order
+#include "gl_command_types.inl"
     _COUNT,  // sentinel value (keep this as the last element in enum to always have a count
              // of enum elements)
 };
 
-enum class GLRemixClientArrayType : UINT32
+enum class GLRemixClientArrayType : UINT8
 {
     VERTEX,    // GL_VERTEX_ARRAY
     NORMAL,    // GL_NORMAL_ARRAY
@@ -105,26 +33,110 @@ enum class GLRemixClientArrayType : UINT32
 };
 
 /* HEADER STRUCTS */
+// layout of the records below, bumped whenever a header or command changes on the wire
+constexpr UINT32 k_GLCMD_WIRE_VERSION = 6;
+
+constexpr UINT32 k_GLCMD_TYPE_BITS = 8;
+constexpr UINT32 k_GLCMD_LONG_BYTES = 0xFFFFFFFFu >> k_GLCMD_TYPE_BITS;  // size bits all ones
+
+static_assert(static_cast<UINT32>(GLCommandType::_COUNT) <= 1u << k_GLCMD_TYPE_BITS);
+
+/*
+ * One packed word in front of every record: `GLCommandType` in the low `k_GLCMD_TYPE_BITS`,
+ * payload bytes above them. Payloads of `k_GLCMD_LONG_BYTES` or more (inline pixels in an
+ * overflow segment) set the size bits to all ones and carry their size in a second word.
+ */
 struct GLCommandHeader
 {
-    GLCommandType type;
-    UINT32 cmd_bytes;
-};
-
-// per-frame uniforms for OpenGL commands sent via IPC
+    UINT32 packed;
+
+    // bytes the header of a `cmd_bytes` payload takes
+    static constexpr UINT32 get_bytes_for(const UINT32 cmd_bytes)
+    {
+        return cmd_bytes < k_GLCMD_LONG_BYTES ? sizeof(UINT32) : 2 * sizeof(UINT32);
+    }
+
+    // `out` needs room for two words, returns the bytes written
+    static UINT32 write(UINT32* out, const GLCommandType type, const UINT32 cmd_bytes)
+    {
+        const UINT32 type_bits = static_cast<UINT32>(type);
+        if (cmd_bytes < k_GLCMD_LONG_BYTES)
+        {
+            out[0] = type_bits | cmd_bytes << k_GLCMD_TYPE_BITS;
+            return sizeof(UINT32);
+        }
+        out[0] = type_bits | k_GLCMD_LONG_BYTES << k_GLCMD_TYPE_BITS;
+        out[1] = cmd_bytes;
+        return 2 * sizeof(UINT32);
+    }
+
+    GLCommandType get_type() const
+    {
+        return static_cast<GLCommandType>(packed & ((1u << k_GLCMD_TYPE_BITS) - 1));
+    }
+
+    bool is_long() const
+    {
+        return packed >> k_GLCMD_TYPE_BITS == k_GLCMD_LONG_BYTES;
+    }
+
+    UINT32 get_cmd_bytes() const
+    {
+        return is_long() ? (&packed)[1] : packed >> k_GLCMD_TYPE_BITS;
+    }
+
+    UINT32 get_bytes() const
+    {
+        return is_long() ? 2 * sizeof(UINT32) : sizeof(UINT32);
+    }
+
+    const void* get_payload() const
+    {
+        return reinterpret_cast<const UINT8*>(this) + get_bytes();
+    }
+};
+
+// per-frame uniforms for OpenGL commands sent via IPC, payload of the frame marker commands
 struct GLFrameHeader
 {
     UINT32 frame_index;  // incremental frame counter
-    UINT32 frame_bytes;  // bytes following this ipc_payload
+    UINT32 frame_bytes;  // command bytes recorded between the frame markers
+    UINT32 bulk_cursor;  // end of the frame's bulk arena allocations, frame end marker only
+};
+
+// payload stored in the bulk arena instead of inline after the command, 0 bytes means inline
+struct GLBulkHandle
+{
+    UINT32 offset;  // from the start of the arena
+    UINT32 bytes;
+};
+
+// 64-bit content hash split so commands keep 4 byte alignment in the stream, 0 means none
+struct GLContentHash
+{
+    UINT32 lo;
+    UINT32 hi;
 };
 
+// how a client array crosses the ring, static arrays only do once
+enum class GLRemixArrayResidency : UINT32
+{
+    SENT,      // bytes follow, the renderer reads them for this draw only
+    CACHE,     // bytes follow, the renderer also keeps them under `content_hash`
+    RESIDENT,  // no bytes follow, the renderer already keeps them under `content_hash`
+    LOCKED,    // no bytes follow, the renderer reads them from the last `GLREMIXCMD_LOCK_ARRAYS`
+};
+
+// only enabled arrays send one, see `GLRemixDrawArraysCommand`
 struct GLRemixClientArrayHeader
 {
-    UINT32 size;
-    UINT32 type;
-    UINT32 stride;
-    UINT32 array_bytes;
     GLRemixClientArrayType array_type;
+    UINT8 size;   // components per element
+    UINT16 type;  // GL_FLOAT, GL_UNSIGNED_BYTE, ...
+    UINT32 stride;
+    UINT32 array_bytes;  // the array's size, even when resident
+    GLRemixArrayResidency residency;
+    GLContentHash content_hash;  // of the bytes and the fields above, the resident array id
 };
 
 /* COMPONENT STRUCTS */
@@ -172,6 +184,32 @@ using GLColor4fCommand = GLVec4f;
 using GLNormal3fCommand = GLVec3f;
 using GLTexCoord2fCommand = GLVec2f;
 
+// attributes a vertex batch may carry per vertex, in payload order
+enum class GLRemixVertexAttribute : UINT32
+{
+    COLOR,     // GLVec4f
+    NORMAL,    // GLVec3f
+    TEXCOORD,  // GLVec2f
+    _COUNT
+};
+
+/*
+ * One record for a whole `glBegin` / `glEnd` pair instead of one per call.
+ * Followed by `count` positions (GLVec3f), then for every attribute in `attributes` its values
+ * for vertices [`first`, `count`) in SoA layout. Vertices before `first` use the current value.
+ * `color`, `normal` and `uv` hold the values last set in the batch, they stay current after it.
+ */
+struct GLRemixVertexBatchCommand
+{
+    UINT32 mode;
+    UINT32 count;
+    UINT32 attributes;  // bit per `GLRemixVertexAttribute` set inside the batch
+    UINT32 first[static_cast<UINT32>(GLRemixVertexAttribute::_COUNT)];
+    GLVec4f color;
+    GLVec3f normal;
+    GLVec2f uv;
+};
+
 /* DISPLAY LISTS */
 struct GLCallListCommand
 {
@@ -187,24 +225,35 @@ struct GLNewListCommand
 using GLEndListCommand = GLEmptyCommand;
 
 /* CLIENT STATE */
+/*
+ * The draw commands are followed by `enabled` `GLRemixClientArrayHeader`s, one per enabled array
+ * in `GLRemixClientArrayType` order, then by the arrays themselves unless they went to the bulk
+ * arena. Resident arrays send no bytes, see `GLRemixArrayResidency`.
+ */
 struct GLRemixDrawArraysCommand
 {
     UINT32 mode;
     UINT32 first;
     UINT32 count;
-    UINT32 enabled;  // amount of currently enabled client array kinds (<= 6)
-    GLRemixClientArrayHeader headers[static_cast<UINT32>(GLRemixClientArrayType::_COUNT)];
+    UINT32 enabled;  // amount of client array headers following the command
+    // enabled arrays back to back, inline after the headers if empty
+    GLBulkHandle client_data;
 };
 
+// indices as the game passed them, arrays hold vertices [start, end] only
 struct GLRemixDrawElementsCommand
 {
     UINT32 mode;
+    UINT32 start;  // smallest index
+    UINT32 end;    // largest index
     UINT32 count;
     UINT32 type;
     UINT32 enabled;
-    GLRemixClientArrayHeader headers[static_cast<UINT32>(GLRemixClientArrayType::_COUNT)];
+    // enabled arrays back to back, inline after the headers if empty
+    GLBulkHandle client_data;
 };
 
+// same layout, with the range `glDrawRangeElements` promised
 struct GLRemixDrawRangeElementsCommand
 {
     UINT32 mode;
@@ -213,7 +262,22 @@ struct GLRemixDrawRangeElementsCommand
     UINT32 count;
     UINT32 type;
     UINT32 enabled;
-    GLRemixClientArrayHeader headers[static_cast<UINT32>(GLRemixClientArrayType::_COUNT)];
+    // enabled arrays back to back, inline after the headers if empty
+    GLBulkHandle client_data;
+};
+
+/*
+ * Arrays `glLockArraysEXT` froze, vertices [first, first + count) of every enabled array, sent
+ * like the draws send theirs. Draws inside the range mark those arrays `LOCKED` until the next
+ * lock replaces them, `glUnlockArraysEXT` sends nothing.
+ */
+struct GLRemixLockArraysCommand
+{
+    UINT32 first;
+    UINT32 count;
+    UINT32 enabled;
+    // enabled arrays back to back, inline after the headers if empty
+    GLBulkHandle client_data;
 };
 
 /* MATRIX OPERATIONS */
@@ -316,6 +380,8 @@ struct GLTexImage2DCommand
     UINT32 border;  // the width of the border. must be either 0 or 1.
     UINT32 format;
     UINT32 type;
+    GLContentHash pixels_hash;  // of the pixels and the fields above
+    GLBulkHandle pixels;        // inline after the command if empty
 };
 
 struct GLTexParameterCommand
@@ -368,13 +434,6 @@ struct GLMaterialfCommand
     float param;
 };
 
-struct GLMaterialivCommand
-{
-    UINT32 face;
-    UINT32 pname;
-    GLVec4f params;
-};
-
 struct GLMaterialfvCommand
 {
     UINT32 face;
@@ -382,6 +441,8 @@ struct GLMaterialfvCommand
     GLVec4f params;
 };
 
+using GLMaterialivCommand = GLMaterialfvCommand;  // the shim converts the ints
+
 struct GLAlphaFuncCommand
 {
     UINT32 func;
@@ -460,13 +521,33 @@ struct GLStencilOpSeparateATICommand
 
 struct WGLCreateContextCommand
 {
-    HWND hwnd;  // NOTE: 32-bit in x86 shim, 64-bit in x64 shim
+    UINT64 hwnd;  // widened so x86 and x64 shims send the same payload
 };
 
-struct WGLInputEventCommand
+/* SCHEMA */
+// payload struct of each command, `IPCProtocol::write_command<Type>` takes only this
+template<GLCommandType Type>
+struct GLCommandTraits;
+
+enum class GLPayloadLayout : UINT8
 {
-    UINT32 msg;
-    UINT64 wparam;
-    UINT64 lparam;
+    NONE,        // not a command
+    FIXED,       // payload is exactly the struct
+    TRAILING,    // struct followed by the data it describes
+    IPC_MARKER,  // consumed by `IPCProtocol`
 };
+
+struct GLCommandLayout
+{
+    UINT32 payload_bytes;  // sizeof the struct, a minimum for `TRAILING`
+    GLPayloadLayout kind;
+};
+
+// traits and `k_GLCMD_LAYOUTS`, indexed by `GLCommandType`
+#include "gl_command_layouts.inl"
+
+constexpr const GLCommandLayout& get_command_layout(const GLCommandType type)
+{
+    return k_GLCMD_LAYOUTS[static_cast<UINT32>(type)];
+}
 }  // namespace glRemix
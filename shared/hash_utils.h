@@ -0,0 +1,90 @@
+#pragma once
+
+#include "platform.h"
+
+#include <cstring>
+
+// 64-bit non-cryptographic content hash (xxHash64 rounds), used to recognize repeated payloads
+
+constexpr UINT64 k_HASH_PRIME_1 = 0x9E3779B185EBCA87ull;
+constexpr UINT64 k_HASH_PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr UINT64 k_HASH_PRIME_3 = 0x165667B19E3779F9ull;
+constexpr UINT64 k_HASH_PRIME_4 = 0x85EBCA77C2B2AE63ull;
+constexpr UINT64 k_HASH_PRIME_5 = 0x27D4EB2F165667C5ull;
+
+inline UINT64 rotl_u64(const UINT64 value, const int bits)
+{
+    return value << bits | value >> (64 - bits);
+}
+
+inline UINT64 hash_round(UINT64 acc, const UINT64 lane)
+{
+    acc += lane * k_HASH_PRIME_2;
+    return rotl_u64(acc, 31) * k_HASH_PRIME_1;
+}
+
+inline UINT64 hash_merge_round(const UINT64 acc, const UINT64 lane)
+{
+    return (acc ^ hash_round(0, lane)) * k_HASH_PRIME_1 + k_HASH_PRIME_4;
+}
+
+inline UINT64 hash_content(const void* data, const size_t bytes, const UINT64 seed = 0)
+{
+    const auto* p = static_cast<const UINT8*>(data);
+    const UINT8* const end = p + bytes;
+
+    auto read_u64 = [](const UINT8* src)
+    {
+        UINT64 value;
+        memcpy(&value, src, sizeof(value));  // payloads are only 4 byte aligned in the stream
+        return value;
+    };
+
+    UINT64 h;
+    if (bytes >= 32)
+    {
+        // four independent lanes keep the multiplies pipelined
+        UINT64 v1 = seed + k_HASH_PRIME_1 + k_HASH_PRIME_2;
+        UINT64 v2 = seed + k_HASH_PRIME_2;
+        UINT64 v3 = seed;
+        UINT64 v4 = seed - k_HASH_PRIME_1;
+        for (; end - p >= 32; p += 32)
+        {
+            v1 = hash_round(v1, read_u64(p));
+            v2 = hash_round(v2, read_u64(p + 8));
+            v3 = hash_round(v3, read_u64(p + 16));
+            v4 = hash_round(v4, read_u64(p + 24));
+        }
+
+        h = rotl_u64(v1, 1) + rotl_u64(v2, 7) + rotl_u64(v3, 12) + rotl_u64(v4, 18);
+        h = hash_merge_round(h, v1);
+        h = hash_merge_round(h, v2);
+        h = hash_merge_round(h, v3);
+        h = hash_merge_round(h, v4);
+    }
+    else
+    {
+        h = seed + k_HASH_PRIME_5;
+    }
+
+    h += bytes;
+
+    for (; end - p >= 8; p += 8)
+    {
+        h ^= hash_round(0, read_u64(p));
+        h = rotl_u64(h, 27) * k_HASH_PRIME_1 + k_HASH_PRIME_4;
+    }
+    for (; p < end; p++)
+    {
+        h ^= *p * k_HASH_PRIME_5;
+        h = rotl_u64(h, 11) * k_HASH_PRIME_1;
+    }
+
+    // avalanche
+    h ^= h >> 33;
+    h *= k_HASH_PRIME_2;
+    h ^= h >> 29;
+    h *= k_HASH_PRIME_3;
+    h ^= h >> 32;
+    return h;
+}
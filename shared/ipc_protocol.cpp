@@ -1,80 +1,972 @@
 #include "ipc_protocol.h"
 
-#include <sstream>
 #include <algorithm>
 #include <thread>
 #include <chrono>
+#include <new>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <utility>
 
-#include <format>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static void s_cpu_relax()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+namespace glRemix
+{
+struct IPCThreadChunk
+{
+    explicit IPCThreadChunk(const UINT32 bytes)
+        : data(std::make_unique_for_overwrite<UINT8[]>(bytes)), capacity(bytes)
+    {
+    }
+
+    std::unique_ptr<UINT8[]> data;
+    UINT32 capacity;
+    std::atomic<UINT32> committed = 0;  // bytes of complete records
+    std::atomic<IPCThreadChunk*> next = nullptr;
+};
+
+/*
+ * Records of one thread that isn't the writer thread, each prefixed with its sequence number.
+ * Only that thread appends and only the writer thread merges, so chunks are handed over like the
+ * ring: `committed` is released once a whole record is in place, and the next chunk is linked
+ * only after the last record went into the previous one.
+ */
+struct IPCThreadBuffer
+{
+    const IPCProtocol* protocol;
+    std::thread::id thread;
+    IPCThreadBuffer* next = nullptr;  // in the protocol's list
+
+    // recording thread
+    IPCThreadChunk* tail;
+    UINT32 tail_bytes = 0;  // end of the last complete record in `tail`
+    UINT8* record_ptr = nullptr;
+    UINT32 record_remaining = 0;  // 0 while no record is being written
+    UINT32 record_end = 0;
+    bool record_reserved = false;  // between `reserve` and `commit`, not complete before both
+
+    // writer (or publisher) thread
+    IPCThreadChunk* head;
+    UINT32 merged = 0;  // offset into `head`
+
+    // drained chunks on their way back, pushed by the merging side and popped by the recording one
+    std::atomic<IPCThreadChunk*> free_chunks = nullptr;
+};
+}  // namespace glRemix
+
+// keeps the sequence number of every thread record aligned
+constexpr UINT32 k_THREAD_RECORD_ALIGNMENT = alignof(UINT64);
+
+// Only the recording thread pops, so a chunk can't be popped and pushed again under it (no ABA)
+static glRemix::IPCThreadChunk* s_pop_free_chunk(glRemix::IPCThreadBuffer& buffer)
+{
+    glRemix::IPCThreadChunk* chunk = buffer.free_chunks.load(std::memory_order_acquire);
+    while (chunk
+           && !buffer.free_chunks.compare_exchange_weak(chunk,
+                                                        chunk->next.load(std::memory_order_relaxed),
+                                                        std::memory_order_acquire))
+    {
+    }
+
+    if (chunk)
+    {
+        // it is linked with a release store, which publishes the reset to the merging side
+        chunk->next.store(nullptr, std::memory_order_relaxed);
+        chunk->committed.store(0, std::memory_order_relaxed);
+    }
+    return chunk;
+}
+
+// hands the finished record to the merging side
+static void s_commit_thread_record(glRemix::IPCThreadBuffer& buffer)
+{
+    buffer.tail_bytes = buffer.record_end;
+    buffer.tail->committed.store(buffer.tail_bytes, std::memory_order_release);
+}
+
+// buffer of the stream this thread last recorded into without being its writer thread
+static thread_local glRemix::IPCThreadBuffer* g_thread_buffer = nullptr;
+
+// set on publisher threads, whose waits don't stall the game
+static thread_local bool g_on_publisher = false;
+
+// Spinning only pays off when the other side runs on another core at the same time
+static UINT32 s_initial_spin_limit()
+{
+    return std::thread::hardware_concurrency() > 1 ? glRemix::k_IPC_INITIAL_SPIN : 0;
+}
+
+glRemix::IPCProtocol::IPCProtocol() : IPCProtocol(create_platform_transport()) {}
+
+glRemix::IPCProtocol::IPCProtocol(std::unique_ptr<IPCTransport> transport)
+    : m_transport(std::move(transport)), m_spin_limit(s_initial_spin_limit())
+{
+}
+
+glRemix::IPCProtocol::~IPCProtocol()
+{
+    if (m_publisher.joinable())
+    {
+        m_publisher_stop.store(true, std::memory_order_release);
+        m_frames_submitted.fetch_add(1, std::memory_order_release);
+        m_frames_submitted.notify_one();
+        m_publisher.join();
+    }
+
+    for (OverflowSegment& overflow : m_overflow)
+    {
+        if (overflow.region.native)
+        {
+            m_transport->close_region(&overflow.region);
+        }
+    }
+    if (m_ring.native)
+    {
+        m_transport->close_region(&m_ring);
+    }
+    if (m_content_acks.native)
+    {
+        m_transport->close_region(&m_content_acks);
+    }
+    if (m_bulk.native)
+    {
+        m_transport->close_region(&m_bulk);
+    }
+    if (m_lease_region.native)
+    {
+        m_transport->close_region(&m_lease_region);
+    }
+    if (m_write_signal.native)
+    {
+        m_transport->close_signal(&m_write_signal);
+    }
+    if (m_read_signal.native)
+    {
+        m_transport->close_signal(&m_read_signal);
+    }
+
+    IPCThreadBuffer* buffer = m_thread_buffers.load(std::memory_order_acquire);
+    while (buffer)
+    {
+        for (IPCThreadChunk* chunk : { buffer->head, buffer->free_chunks.load() })
+        {
+            while (chunk)
+            {
+                delete std::exchange(chunk, chunk->next.load(std::memory_order_relaxed));
+            }
+        }
+        delete std::exchange(buffer, buffer->next);
+    }
+}
+
+/*
+ * Blocks until `ready()` holds. Spins on the shared cursors first, the other side is often only
+ * microseconds away at high frame rates, then sleeps on `signal`. `waiting` tells the other side
+ * to notify `signal`, it is raised before re-checking so a publish racing with us can't be missed.
+ * The spin budget follows how long the other side actually takes: it grows to twice the spins a
+ * hit needed and halves whenever spinning was in vain.
+ */
+template<typename Predicate>
+void glRemix::IPCProtocol::wait_until(std::atomic<UINT32>& waiting, const IPCSignal& signal,
+                                      Predicate ready)
+{
+    if (ready())
+    {
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool writer = &waiting == &m_control->writer_waiting;
+
+    UINT32 spins = 0;
+    while (spins < m_spin_limit && !ready())
+    {
+        s_cpu_relax();
+        spins++;
+    }
+
+    const bool spin_hit = spins < m_spin_limit;
+    if (spin_hit)
+    {
+        m_spin_limit = std::clamp(spins * 2, m_spin_limit, k_IPC_MAX_SPIN);
+    }
+    else if (m_spin_limit > 0)
+    {
+        m_spin_limit = std::max(m_spin_limit / 2, k_IPC_MIN_SPIN);
+    }
+    (writer ? (spin_hit ? m_control->writer_spin_hits : m_control->writer_sleeps)
+            : (spin_hit ? m_control->reader_spin_hits : m_control->reader_sleeps))
+        .fetch_add(1, std::memory_order_relaxed);
+
+    while (!spin_hit && !ready())
+    {
+        const UINT32 token = m_transport->prepare_wait(signal);
+        waiting.store(1, std::memory_order_seq_cst);
+        if (ready())
+        {
+            waiting.store(0, std::memory_order_relaxed);
+            break;
+        }
+
+        const bool woken = m_transport->wait(signal, token);
+        waiting.store(0, std::memory_order_relaxed);
+
+        if (!woken)
+        {
+            // this is a runtime_error as it is unpredictable to my knowledge
+            throw std::runtime_error(
+                FSTR("IPCProtocol - {} transport wait failed.", m_transport->get_name()));
+        }
+    }
+
+    // only the writer's stalls are interesting, a publisher's are not time the game lost
+    if (writer)
+    {
+        count_blocked(g_on_publisher ? m_control->publisher_blocked_ns
+                                     : m_control->writer_blocked_ns,
+                      g_on_publisher ? m_control->publisher_blocked_count
+                                     : m_control->writer_blocked_count,
+                      start);
+    }
+}
+
+void glRemix::IPCProtocol::count_blocked(std::atomic<UINT64>& blocked_ns,
+                                         std::atomic<UINT64>& blocked_count,
+                                         const std::chrono::steady_clock::time_point start)
+{
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    blocked_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                         std::memory_order_relaxed);
+    blocked_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void glRemix::IPCProtocol::wake(const std::atomic<UINT32>& waiting, const IPCSignal& signal)
+{
+    if (waiting.load(std::memory_order_seq_cst))
+    {
+        m_transport->notify(signal);
+    }
+}
 
 void glRemix::IPCProtocol::init_writer()
 {
-    if (!m_slot_A.smem.create_for_writer(k_MAP_A, k_WRITE_EVENT_A, k_READ_EVENT_A))
+    m_transport->set_map_options(m_map_options);
+
+    // stream 0 is always created first and owns the content acks the other streams share
+    const bool acks_ok = m_stream == 0
+                             ? m_transport->create_region(k_CONTENT_ACK_MAP,
+                                                          sizeof(IPCContentAckTable),
+                                                          &m_content_acks)
+                             : m_transport->open_region(k_CONTENT_ACK_MAP,
+                                                        sizeof(IPCContentAckTable),
+                                                        &m_content_acks);
+
+    if (!acks_ok
+        || !m_transport->create_region(stream_name(k_RING_MAP).c_str(),
+                                       k_IPC_RING_CONTROL_BYTES + k_IPC_RING_CAPACITY, &m_ring)
+        || !m_transport->create_signal(stream_name(k_RING_WRITE_EVENT).c_str(), &m_write_signal)
+        || !m_transport->create_signal(stream_name(k_RING_READ_EVENT).c_str(), &m_read_signal))
+    {
+        throw std::runtime_error(FSTR("IPCProtocol.WRITER - Failed to create {} ring transport",
+                                      m_transport->get_name()));
+    }
+
+    if (m_bulk_window >= k_IPC_BULK_CAPACITY)
+    {
+        m_bulk_window = 0;
+    }
+    if (m_bulk_window > 0)
+    {
+        // views move in `k_IPC_VIEW_ALIGNMENT` steps, large pages can't follow them
+        m_transport->set_map_options(
+            { .prefault = m_map_options.prefault, .view_bytes = m_bulk_window });
+    }
+    if (!m_transport->create_region(stream_name(k_BULK_MAP).c_str(), k_IPC_BULK_CAPACITY, &m_bulk))
+    {
+        throw std::runtime_error(FSTR("IPCProtocol.WRITER - Failed to create {} bulk arena",
+                                      m_transport->get_name()));
+    }
+
+    m_transport->set_map_options({ .large_pages = m_map_options.large_pages });
+
+    m_control = new (m_ring.data) IPCRingControl{};
+    m_control->version = k_IPC_RING_VERSION;
+    m_control->wire_version = k_GLCMD_WIRE_VERSION;
+    m_control->capacity = k_IPC_RING_CAPACITY;
+    m_control->frame_policy.store(static_cast<UINT32>(m_frame_policy), std::memory_order_relaxed);
+
+    m_data = m_ring.data + k_IPC_RING_CONTROL_BYTES;
+    m_capacity = k_IPC_RING_CAPACITY;
+
+    m_control->magic.store(k_IPC_RING_MAGIC, std::memory_order_release);
+}
+
+void glRemix::IPCProtocol::set_stream(const UINT32 stream, IPCProtocol* directory)
+{
+    if (stream >= k_IPC_MAX_STREAMS || m_control)
+    {
+        // this is a logic error as the caller picks streams out of a fixed pool before init
+        throw std::logic_error(
+            FSTR("IPCProtocol - Stream {} is invalid or set after init.", stream));
+    }
+
+    m_stream = stream;
+    m_directory = directory;
+}
+
+std::string glRemix::IPCProtocol::stream_name(const char* name) const
+{
+    if (m_stream == 0)
+    {
+        return name;
+    }
+
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), k_STREAM_SUFFIX_FORMAT, m_stream);
+    return std::string(name) + suffix;
+}
+
+void glRemix::IPCProtocol::set_bulk_window(const UINT32 window_bytes)
+{
+    // the view must hold a whole allocation behind an aligned offset, see `map_bulk`
+    if (window_bytes % k_IPC_VIEW_ALIGNMENT != 0
+        || (window_bytes > 0 && window_bytes < 2 * k_IPC_VIEW_ALIGNMENT))
+    {
+        throw std::logic_error(
+            FSTR("IPCProtocol.WRITER - Bulk window of {} bytes is not a multiple of {} (min {}).",
+                 window_bytes, k_IPC_VIEW_ALIGNMENT, 2 * k_IPC_VIEW_ALIGNMENT));
+    }
+
+    m_bulk_window = window_bytes;
+}
+
+void glRemix::IPCProtocol::set_frame_policy(const IPCFramePolicy policy, const UINT32 queue_depth)
+{
+    if (policy == IPCFramePolicy::FIFO && (queue_depth == 0 || queue_depth > k_IPC_MAX_QUEUE_DEPTH))
+    {
+        throw std::logic_error(
+            FSTR("IPCProtocol.WRITER - FIFO queue depth {} is outside [1, {}].", queue_depth,
+                 k_IPC_MAX_QUEUE_DEPTH));
+    }
+
+    m_frame_policy = policy;
+    m_queue_depth = policy == IPCFramePolicy::FIFO ? queue_depth : k_IPC_MAX_FRAMES_AHEAD;
+
+    if (m_control)
+    {
+        m_control->frame_policy.store(static_cast<UINT32>(policy), std::memory_order_relaxed);
+    }
+}
+
+void glRemix::IPCProtocol::start_frame_or_wait()
+{
+    if (!m_control)
+    {
+        throw std::logic_error("IPCProtocol.WRITER - Ring is not mapped at time of frame start.");
+    }
+
+    // the publisher starts the next frame as soon as it has written the last one
+    if (m_publisher.joinable())
+    {
+        return;
+    }
+
+    begin_frame();
+}
+
+void glRemix::IPCProtocol::begin_frame()
+{
+    // mailbox never waits here, the reader drops whatever it can't keep up with
+    if (m_frame_policy != IPCFramePolicy::MAILBOX)
+    {
+        wait_until(m_control->writer_waiting, m_read_signal,
+                   [this]
+                   {
+                       const UINT32 published = m_control->frames_published.load(
+                           std::memory_order_relaxed);
+                       const UINT32 consumed = m_control->frames_consumed.load(
+                           std::memory_order_acquire);
+                       return published - consumed < m_queue_depth;
+                   });
+    }
+
+    m_frame_index++;
+
+    trim_overflow_segments();
+
+    write_marker(GLCommandType::IPCCMD_FRAME_BEGIN,
+                 GLFrameHeader{ .frame_index = m_frame_index, .frame_bytes = 0, .bulk_cursor = 0 });
+
+    m_frame_bytes = 0;  // markers do not count towards the frame
+}
+
+void glRemix::IPCProtocol::end_frame()
+{
+    if (!m_control)
+    {
+        throw std::logic_error("IPCProtocol.WRITER - Ring is not mapped at time of frame end.");
+    }
+    if (!is_writer_thread())
+    {
+        // this is a logic error as the frame would interleave with the writer thread's records
+        throw std::logic_error("IPCProtocol.WRITER - Frame ended off the writer thread.");
+    }
+
+    if (m_publisher.joinable())
+    {
+        hand_off_frame();
+        return;
+    }
+
+    finish_frame(m_record_sequence.load(std::memory_order_relaxed));
+}
+
+void glRemix::IPCProtocol::finish_frame(const UINT64 sequence_limit)
+{
+    merge_thread_records(sequence_limit);
+
+    // the reader frees the arena up to here once it is done with the frame
+    const GLFrameHeader header = { .frame_index = m_frame_index,
+                                   .frame_bytes = m_frame_bytes,
+                                   .bulk_cursor = m_bulk_cursor };
+
+    write_marker(GLCommandType::IPCCMD_FRAME_END, header);
+
+    publish(true);
+
+    m_control->frames_published.fetch_add(1, std::memory_order_seq_cst);
+}
+
+void glRemix::IPCProtocol::start_publisher()
+{
+    if (!m_control || m_publisher.joinable())
+    {
+        // this is a logic error as the publisher needs the ring and there is only one per stream
+        throw std::logic_error("IPCProtocol.WRITER - Publisher started before init or twice.");
+    }
+
+    m_publisher = std::thread([this] { run_publisher(); });
+}
+
+void glRemix::IPCProtocol::hand_off_frame()
+{
+    // double buffered: the previous frame must be in the ring before this one is handed over
+    const UINT32 submitted = m_frames_submitted.load(std::memory_order_relaxed);
+    UINT32 retired = m_frames_retired.load(std::memory_order_acquire);
+    if (retired != submitted)
+    {
+        // the game's only stall with a publisher, its ring waits happen on the publisher thread
+        const auto start = std::chrono::steady_clock::now();
+        for (; retired != submitted; retired = m_frames_retired.load(std::memory_order_acquire))
+        {
+            m_frames_retired.wait(retired, std::memory_order_acquire);
+        }
+        count_blocked(m_control->writer_blocked_ns, m_control->writer_blocked_count, start);
+    }
+
+    m_submitted_sequence = m_record_sequence.load(std::memory_order_relaxed);
+    m_frames_submitted.store(submitted + 1, std::memory_order_release);
+    m_frames_submitted.notify_one();
+}
+
+void glRemix::IPCProtocol::run_publisher()
+{
+    g_on_publisher = true;
+
+    for (UINT32 retired = 0;; retired++)
+    {
+        m_frames_submitted.wait(retired, std::memory_order_acquire);
+        if (m_publisher_stop.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        // the ring's writer side is ours alone from here, the game is recording the next frame
+        finish_frame(m_submitted_sequence);
+        begin_frame();
+
+        m_frames_retired.store(retired + 1, std::memory_order_release);
+        m_frames_retired.notify_one();
+    }
+}
+
+void glRemix::IPCProtocol::set_writer_thread()
+{
+    m_writer_thread.store(std::this_thread::get_id(), std::memory_order_release);
+}
+
+bool glRemix::IPCProtocol::is_writer_thread()
+{
+    const std::thread::id thread = std::this_thread::get_id();
+    std::thread::id writer = m_writer_thread.load(std::memory_order_acquire);
+    if (writer == std::thread::id{})
+    {
+        // on failure `writer` holds the thread that claimed it first
+        m_writer_thread.compare_exchange_strong(writer, thread, std::memory_order_acq_rel);
+        return writer == std::thread::id{} || writer == thread;
+    }
+    return writer == thread;
+}
+
+UINT8* glRemix::IPCProtocol::reserve_record(const GLCommandType type, const UINT32 command_bytes,
+                                            const UINT32 extra_data_bytes)
+{
+    if (!m_control)
+    {
+        throw std::logic_error("IPCProtocol.WRITER - Ring is not mapped at time of writing.");
+    }
+
+    const UINT32 payload_bytes = command_bytes + extra_data_bytes;
+
+    if (!m_publisher.joinable() && is_writer_thread())
+    {
+        begin_ring_record(payload_bytes);
+
+        const UINT32 header_bytes = GLCommandHeader::write(reinterpret_cast<UINT32*>(m_record_ptr),
+                                                           type, payload_bytes);
+        UINT8* command = m_record_ptr + header_bytes;
+        m_record_ptr = command + command_bytes;
+        m_record_remaining -= header_bytes + command_bytes;
+        return command;
+    }
+
+    IPCThreadBuffer* buffer = begin_thread_record(payload_bytes);
+
+    UINT8* record = buffer->record_ptr;
+    const UINT32 header_bytes = GLCommandHeader::write(reinterpret_cast<UINT32*>(record), type,
+                                                       payload_bytes);
+    UINT8* command = record + header_bytes;
+    buffer->record_ptr = command + command_bytes;
+    buffer->record_remaining = extra_data_bytes;
+    buffer->record_reserved = true;
+    return command;
+}
+
+void glRemix::IPCProtocol::commit()
+{
+    IPCThreadBuffer* buffer = g_thread_buffer;
+    if (!buffer || buffer->protocol != this || !buffer->record_reserved)
+    {
+        return;  // ring records are complete once the next one begins
+    }
+
+    buffer->record_reserved = false;
+    if (buffer->record_remaining == 0)
+    {
+        s_commit_thread_record(*buffer);
+    }
+}
+
+glRemix::IPCThreadBuffer* glRemix::IPCProtocol::begin_thread_record(const UINT32 payload_bytes)
+{
+    IPCThreadBuffer* buffer = get_thread_buffer();
+    const UINT32 bytes = sizeof(UINT64) + GLCommandHeader::get_bytes_for(payload_bytes)
+                         + payload_bytes;
+    const UINT32 record_bytes = align_u32(bytes, k_THREAD_RECORD_ALIGNMENT);
+
+    if (buffer->tail_bytes + record_bytes > buffer->tail->capacity)
+    {
+        IPCThreadChunk* chunk = s_pop_free_chunk(*buffer);
+        if (chunk && chunk->capacity < record_bytes)
+        {
+            delete std::exchange(chunk, nullptr);
+        }
+        if (!chunk)
+        {
+            chunk = new IPCThreadChunk(std::max(record_bytes, k_IPC_THREAD_CHUNK_BYTES));
+        }
+        buffer->tail->next.store(chunk, std::memory_order_release);
+        buffer->tail = chunk;
+        buffer->tail_bytes = 0;
+    }
+
+    const UINT64 sequence = m_record_sequence.fetch_add(1, std::memory_order_relaxed);
+    UINT8* record = buffer->tail->data.get() + buffer->tail_bytes;
+    memcpy(record, &sequence, sizeof(sequence));
+
+    buffer->record_ptr = record + sizeof(sequence);
+    buffer->record_remaining = bytes - sizeof(sequence);
+    buffer->record_end = buffer->tail_bytes + record_bytes;
+    return buffer;
+}
+
+void glRemix::IPCProtocol::begin_ring_record(const UINT32 payload_bytes)
+{
+    publish(false);  // everything up to `m_write_cursor` is complete now
+
+    const UINT32 bytes = GLCommandHeader::get_bytes_for(payload_bytes) + payload_bytes;
+    const UINT32 record_bytes = align_u32(bytes, k_IPC_RECORD_ALIGNMENT);
+
+    // big records spill rather than stall on a full ring, small ones just wait for space
+    const bool spill = record_bytes > k_IPC_MAX_RING_RECORD
+                       || (record_bytes >= k_IPC_MIN_SPILL_BYTES && !ring_has_space(record_bytes));
+
+    m_record_ptr = spill ? spill_record(record_bytes) : reserve_ring_record(record_bytes);
+    m_record_remaining = record_bytes;
+    m_frame_bytes += bytes;
+}
+
+void glRemix::IPCProtocol::write_marker(const GLCommandType type, const GLFrameHeader& header)
+{
+    UINT32 command[2];
+    const UINT32 command_bytes = GLCommandHeader::write(command, type, sizeof(header));
+
+    begin_ring_record(sizeof(header));
+    write_record(command, command_bytes);
+    write_record(&header, sizeof(header));
+}
+
+glRemix::IPCThreadBuffer* glRemix::IPCProtocol::get_thread_buffer()
+{
+    if (g_thread_buffer && g_thread_buffer->protocol == this)
+    {
+        return g_thread_buffer;
+    }
+
+    // a thread mostly sticks to one stream, the list is only walked when it switches
+    const std::thread::id thread = std::this_thread::get_id();
+    for (IPCThreadBuffer* buffer = m_thread_buffers.load(std::memory_order_acquire); buffer;
+         buffer = buffer->next)
+    {
+        if (buffer->thread == thread)
+        {
+            return g_thread_buffer = buffer;
+        }
+    }
+
+    auto* chunk = new IPCThreadChunk(k_IPC_THREAD_CHUNK_BYTES);
+    auto* buffer = new IPCThreadBuffer{ .protocol = this, .thread = thread, .tail = chunk,
+                                        .head = chunk };
+
+    buffer->next = m_thread_buffers.load(std::memory_order_relaxed);
+    while (!m_thread_buffers.compare_exchange_weak(buffer->next, buffer,
+                                                   std::memory_order_release,
+                                                   std::memory_order_relaxed))
+    {
+    }
+
+    return g_thread_buffer = buffer;
+}
+
+bool glRemix::IPCProtocol::write_thread_record(const void* ptr, const SIZE_T bytes)
+{
+    IPCThreadBuffer* buffer = g_thread_buffer;
+    if (!buffer || buffer->protocol != this || buffer->record_remaining == 0)
+    {
+        return false;
+    }
+
+    if (bytes > buffer->record_remaining)
+    {
+        // this is a logic error as the caller passed a wrong `extra_data_bytes` to write_command
+        throw std::logic_error(
+            FSTR("IPCProtocol.WRITER - Writing {} bytes overruns the reserved command record.",
+                 bytes));
+    }
+
+    memcpy(buffer->record_ptr, ptr, bytes);
+    buffer->record_ptr += bytes;
+    buffer->record_remaining -= static_cast<UINT32>(bytes);
+
+    if (buffer->record_remaining == 0 && !buffer->record_reserved)
+    {
+        s_commit_thread_record(*buffer);
+    }
+    return true;
+}
+
+// Oldest record of `buffer` not merged yet, frees the chunks its thread has moved past
+static const UINT8* s_peek_thread_record(glRemix::IPCThreadBuffer& buffer)
+{
+    while (true)
+    {
+        glRemix::IPCThreadChunk* chunk = buffer.head;
+
+        // a linked `next` makes the final `committed` of this chunk visible
+        glRemix::IPCThreadChunk* next = chunk->next.load(std::memory_order_acquire);
+        if (buffer.merged < chunk->committed.load(std::memory_order_acquire))
+        {
+            return chunk->data.get() + buffer.merged;
+        }
+        if (!next)
+        {
+            return nullptr;
+        }
+
+        // the recording thread takes chunks back instead of allocating every frame
+        glRemix::IPCThreadChunk* top = buffer.free_chunks.load(std::memory_order_relaxed);
+        do
+        {
+            chunk->next.store(top, std::memory_order_relaxed);
+        } while (!buffer.free_chunks.compare_exchange_weak(top, chunk, std::memory_order_release,
+                                                           std::memory_order_relaxed));
+        buffer.head = next;
+        buffer.merged = 0;
+    }
+}
+
+// Records from `sequence_limit` on wait for the next frame, so a busy thread can't stall this one
+void glRemix::IPCProtocol::merge_thread_records(const UINT64 sequence_limit)
+{
+    while (true)
+    {
+        IPCThreadBuffer* oldest = nullptr;
+        UINT64 oldest_sequence = sequence_limit;
+
+        for (IPCThreadBuffer* buffer = m_thread_buffers.load(std::memory_order_acquire); buffer;
+             buffer = buffer->next)
+        {
+            const UINT8* record = s_peek_thread_record(*buffer);
+            if (!record)
+            {
+                continue;
+            }
+
+            UINT64 sequence;
+            memcpy(&sequence, record, sizeof(sequence));
+            if (sequence < oldest_sequence)
+            {
+                oldest = buffer;
+                oldest_sequence = sequence;
+            }
+        }
+
+        if (!oldest)
+        {
+            return;
+        }
+
+        const UINT8* record = oldest->head->data.get() + oldest->merged + sizeof(UINT64);
+        const auto* header = reinterpret_cast<const GLCommandHeader*>(record);
+        const UINT32 cmd_bytes = header->get_cmd_bytes();
+        const UINT32 bytes = header->get_bytes() + cmd_bytes;
+
+        begin_ring_record(cmd_bytes);
+        write_record(record, bytes);
+
+        oldest->merged += align_u32(sizeof(UINT64) + bytes, k_THREAD_RECORD_ALIGNMENT);
+    }
+}
+
+UINT8* glRemix::IPCProtocol::reserve_ring_record(const UINT32 record_bytes)
+{
+    const UINT32 position = m_write_cursor & (m_capacity - 1);
+    const UINT32 tail_bytes = m_capacity - position;
+
+    // records are contiguous, pad out the end of the ring if this one doesn't fit
+    if (record_bytes > tail_bytes)
+    {
+        wait_for_space(tail_bytes + record_bytes);
+
+        if (tail_bytes >= sizeof(GLCommandHeader))
+        {
+            GLCommandHeader::write(reinterpret_cast<UINT32*>(m_data + position),
+                                   GLCommandType::IPCCMD_WRAP,
+                                   tail_bytes - static_cast<UINT32>(sizeof(GLCommandHeader)));
+        }
+
+        m_write_cursor += tail_bytes;
+    }
+    else
+    {
+        wait_for_space(record_bytes);
+    }
+
+    UINT8* record = m_data + (m_write_cursor & (m_capacity - 1));
+    m_write_cursor += record_bytes;
+    update_fast_bytes();
+    return record;
+}
+
+// Room behind `m_write_cursor` that is known free and needs neither a publish nor a wrap
+void glRemix::IPCProtocol::update_fast_bytes()
+{
+    const UINT32 pending = m_write_cursor - m_published_cursor;
+    const UINT32 tail_bytes = m_capacity - (m_write_cursor & (m_capacity - 1));
+    const UINT32 free_bytes = m_capacity - (m_write_cursor - m_seen_read_cursor);
+
+    m_fast_bytes = pending >= k_IPC_PUBLISH_BYTES
+                       ? 0
+                       : std::min({ k_IPC_PUBLISH_BYTES - pending, tail_bytes, free_bytes });
+}
+
+bool glRemix::IPCProtocol::ring_has_space(const UINT32 record_bytes)
+{
+    const UINT32 tail_bytes = m_capacity - (m_write_cursor & (m_capacity - 1));
+    return has_free_space(record_bytes > tail_bytes ? tail_bytes + record_bytes : record_bytes);
+}
+
+// the reader moves `read_cursor` all the time, only go to its cache line when the last value falls
+// short, the space it left is free either way
+bool glRemix::IPCProtocol::has_free_space(const UINT32 bytes)
+{
+    if (m_write_cursor - m_seen_read_cursor + bytes <= m_capacity)
+    {
+        return true;
+    }
+
+    m_seen_read_cursor = m_control->read_cursor.load(std::memory_order_acquire);
+    return m_write_cursor - m_seen_read_cursor + bytes <= m_capacity;
+}
+
+UINT8* glRemix::IPCProtocol::spill_record(const UINT32 record_bytes)
+{
+    const UINT32 segment = acquire_overflow_segment(record_bytes);
+
+    OverflowSegment& overflow = m_overflow[segment];
+    overflow.last_used_frame = m_frame_index;
+
+    // the reference is published together with the next record, after the payload is written
+    const IPCOverflowRef ref = { .segment = segment,
+                                 .generation = overflow.generation,
+                                 .record_bytes = record_bytes };
+
+    UINT8* ref_record = reserve_ring_record(
+        align_u32(sizeof(GLCommandHeader) + sizeof(IPCOverflowRef), k_IPC_RECORD_ALIGNMENT));
+    const UINT32 header_bytes = GLCommandHeader::write(reinterpret_cast<UINT32*>(ref_record),
+                                                       GLCommandType::IPCCMD_OVERFLOW,
+                                                       sizeof(IPCOverflowRef));
+    memcpy(ref_record + header_bytes, &ref, sizeof(IPCOverflowRef));
+
+    return overflow.region.data;
+}
+
+UINT32 glRemix::IPCProtocol::acquire_overflow_segment(const UINT32 bytes)
+{
+    // smallest free segment that fits, otherwise the smallest free one to (re)create
+    auto find_free = [this, bytes]
     {
-        throw std::runtime_error("IPCProtocol.WRITER - Failed to create SharedMemory A");
-    }
-    if (!m_slot_B.smem.create_for_writer(k_MAP_B, k_WRITE_EVENT_B, k_READ_EVENT_B))
+        UINT32 best = k_IPC_MAX_OVERFLOW_SEGMENTS;
+        UINT32 fallback = k_IPC_MAX_OVERFLOW_SEGMENTS;
+        for (UINT32 i = 0; i < k_IPC_MAX_OVERFLOW_SEGMENTS; i++)
+        {
+            if (m_control->overflow_busy[i].load(std::memory_order_acquire))
+            {
+                continue;
+            }
+
+            const UINT32 capacity = m_overflow[i].region.capacity;
+            if (capacity >= bytes)
+            {
+                if (best == k_IPC_MAX_OVERFLOW_SEGMENTS || capacity < m_overflow[best].region.capacity)
+                {
+                    best = i;
+                }
+            }
+            else if (fallback == k_IPC_MAX_OVERFLOW_SEGMENTS
+                     || capacity < m_overflow[fallback].region.capacity)
+            {
+                fallback = i;
+            }
+        }
+        return best != k_IPC_MAX_OVERFLOW_SEGMENTS ? best : fallback;
+    };
+
+    UINT32 segment = find_free();
+    if (segment == k_IPC_MAX_OVERFLOW_SEGMENTS)
     {
-        throw std::runtime_error("IPCProtocol.WRITER - Failed to create SharedMemory B");
+        publish(true);  // reader can only release segments it can see
+
+        wait_until(m_control->writer_waiting, m_read_signal,
+                   [&]
+                   {
+                       segment = find_free();
+                       return segment != k_IPC_MAX_OVERFLOW_SEGMENTS;
+                   });
     }
-}
 
-void glRemix::IPCProtocol::start_frame_or_wait()
-{
+    OverflowSegment& overflow = m_overflow[segment];
+    if (overflow.region.capacity < bytes)
     {
-        MemorySlot* oldest;  // shared memory that has the smaller recorded time frame
-        MemorySlot* latest;  // shared memory that has the larger recorded time frame
-        if (m_slot_A < m_slot_B)
+        const UINT32 capacity = std::max(k_IPC_MIN_OVERFLOW_CAPACITY, std::bit_ceil(bytes));
+
+        // new name per generation so a stale mapping of the old size can never be reopened
+        if (overflow.region.native)
         {
-            oldest = &m_slot_A;
-            latest = &m_slot_B;
+            m_transport->close_region(&overflow.region);
         }
-        else
+        overflow.generation++;
+
+        char name[64];
+        snprintf(name, sizeof(name), k_OVERFLOW_MAP_FORMAT, segment, overflow.generation);
+        if (!m_transport->create_region(stream_name(name).c_str(), capacity, &overflow.region))
         {
-            oldest = &m_slot_B;
-            latest = &m_slot_A;
+            throw std::runtime_error(
+                FSTR("IPCProtocol.WRITER - Failed to create overflow segment {} of {} bytes",
+                     segment, capacity));
         }
+    }
 
-        HANDLE tmp_events[2] = { oldest->smem.get_read_event(), latest->smem.get_read_event() };
-
-        DWORD dw_wait_result = WaitForMultipleObjects(2, tmp_events, false, INFINITE);
+    m_control->overflow_busy[segment].store(1, std::memory_order_relaxed);
+    return segment;
+}
 
-        switch (dw_wait_result)
+void glRemix::IPCProtocol::trim_overflow_segments()
+{
+    // bursts are rare, don't keep their memory committed in steady state
+    for (UINT32 i = 0; i < k_IPC_MAX_OVERFLOW_SEGMENTS; i++)
+    {
+        OverflowSegment& overflow = m_overflow[i];
+        if (overflow.region.capacity == 0
+            || m_control->overflow_busy[i].load(std::memory_order_acquire)
+            || m_frame_index - overflow.last_used_frame <= k_IPC_OVERFLOW_IDLE_FRAMES)
         {
-            case WAIT_OBJECT_0:
-                m_curr_slot = oldest;
-                DBG_PRINT("IPCProtocol.WRITER - Oldest SharedMemory slot became available to "
-                          "write_simple "
-                          "before latest.");  // theoretically should not occur
-                break;
-            case WAIT_OBJECT_0 + 1: m_curr_slot = latest; break;
-            default:
-                // this is a runtime_error as it is unpredictable to my knowledge
-                throw std::runtime_error(FSTR(
-                    "IPCProtocol.WRITER - WaitForMultipleObjects for writer failed. Error Code: {}",
-                    dw_wait_result));
+            continue;
         }
+
+        m_transport->close_region(&overflow.region);
+    }
+}
+
+void glRemix::IPCProtocol::publish(const bool force)
+{
+    const UINT32 pending = m_write_cursor - m_published_cursor;
+    if (pending == 0 || (!force && pending < k_IPC_PUBLISH_BYTES))
+    {
+        return;
     }
 
-    g_frame_index++;
-    m_curr_slot->frame_index = g_frame_index;
+    m_control->write_cursor.store(m_write_cursor, std::memory_order_seq_cst);
+    m_published_cursor = m_write_cursor;
 
-    m_offset = sizeof(GLFrameHeader);  // reset to just the size of GLFrameHeader
+    wake(m_control->reader_waiting, m_write_signal);
+
+    // the renderer only ever sleeps on stream 0, point it at this one
+    if (m_directory)
+    {
+        m_directory->signal_stream(m_stream);
+    }
 }
 
-void glRemix::IPCProtocol::end_frame()
+void glRemix::IPCProtocol::wait_for_space(const UINT32 bytes)
 {
-    if (!m_curr_slot)
+    auto has_space = [this, bytes]
     {
-        throw std::logic_error("IPCProtocol.WRITER - `m_curr_slot` is null at time of frame end.");
-    }
+        return has_free_space(bytes);
+    };
 
-    GLFrameHeader header = { .frame_index = m_curr_slot->frame_index,
-                             .frame_bytes = m_offset - sizeof(GLFrameHeader) };
+    if (has_space())
+    {
+        return;
+    }
 
-    m_curr_slot->smem.write(&header, 0, sizeof(GLFrameHeader));
+    publish(true);  // reader can only free space it can see
 
-    m_curr_slot->smem.signal_write_event();
+    wait_until(m_control->writer_waiting, m_read_signal, has_space);
 }
 
 void glRemix::IPCProtocol::init_reader()
@@ -85,28 +977,36 @@ void glRemix::IPCProtocol::init_reader()
     UINT16 elapsed = 0;
     while (elapsed < MAX_WAIT_MS)
     {
-        bool result_A = m_slot_A.smem.open_for_reader(k_MAP_A, k_WRITE_EVENT_A, k_READ_EVENT_A);
-        bool result_B = m_slot_B.smem.open_for_reader(k_MAP_B, k_WRITE_EVENT_B, k_READ_EVENT_B);
-
-        if (result_A && result_B)
+        // the writer creates the signals after the ring, so wait for all three
+        if (open_ring_for_reader())
         {
-            m_curr_slot = &m_slot_A;
-            return;  // success
+            auto* control = reinterpret_cast<IPCRingControl*>(m_ring.data);
+            if (control->magic.load(std::memory_order_acquire) == k_IPC_RING_MAGIC)
+            {
+                if (control->version != k_IPC_RING_VERSION
+                    || control->wire_version != k_GLCMD_WIRE_VERSION
+                    || control->capacity != k_IPC_RING_CAPACITY)
+                {
+                    throw std::runtime_error(
+                        FSTR("IPCProtocol.READER - Ring version {} / wire version {} / capacity "
+                             "{} does not match renderer.",
+                             control->version, control->wire_version, control->capacity));
+                }
+
+                m_control = control;
+                m_data = m_ring.data + k_IPC_RING_CONTROL_BYTES;
+                m_capacity = control->capacity;
+                m_read_cursor = m_control->read_cursor.load(std::memory_order_relaxed);
+                m_lease_cursor = m_read_cursor;
+                return;  // success
+            }
+
+            DBG_PRINT("IPCProtocol.READER - Ring not initialized after %u milliseconds.", elapsed);
         }
         else
         {
-            if (!result_A)
-            {
-                DBG_PRINT(
-                    "IPCProtocol.READER - Failed to open SharedMemory A after %u milliseconds.",
-                    elapsed);
-            }
-            if (!result_B)
-            {
-                DBG_PRINT(
-                    "IPCProtocol.READER - Failed to open SharedMemory B after %u milliseconds.",
-                    elapsed);
-            }
+            DBG_PRINT("IPCProtocol.READER - Failed to open %s ring after %u milliseconds.",
+                      m_transport->get_name(), elapsed);
         }
 
         std::this_thread::sleep_for(std::chrono::milliseconds(RETRY_MS));
@@ -117,65 +1017,558 @@ void glRemix::IPCProtocol::init_reader()
     throw std::runtime_error("IPCProtocol.READER - Timed out waiting for writer initialization.");
 }
 
-void glRemix::IPCProtocol::consume_frame_or_wait(void* payload, UINT32* frame_index,
-                                                 UINT32* frame_bytes)
+bool glRemix::IPCProtocol::open_ring_for_reader()
+{
+    m_transport->set_map_options(m_map_options);
+
+    if (!m_ring.native
+        && !m_transport->open_region(stream_name(k_RING_MAP).c_str(),
+                                     k_IPC_RING_CONTROL_BYTES + k_IPC_RING_CAPACITY, &m_ring))
+    {
+        return false;
+    }
+    if (!m_write_signal.native
+        && !m_transport->open_signal(stream_name(k_RING_WRITE_EVENT).c_str(), &m_write_signal))
+    {
+        return false;
+    }
+    if (!m_read_signal.native
+        && !m_transport->open_signal(stream_name(k_RING_READ_EVENT).c_str(), &m_read_signal))
+    {
+        return false;
+    }
+    if (!m_content_acks.native
+        && !m_transport->open_region(k_CONTENT_ACK_MAP, sizeof(IPCContentAckTable),
+                                     &m_content_acks))
+    {
+        return false;
+    }
+    if (!m_bulk.native
+        && !m_transport->open_region(stream_name(k_BULK_MAP).c_str(), k_IPC_BULK_CAPACITY, &m_bulk))
+    {
+        return false;
+    }
+
+    // overflow segments the reader opens later are not prefaulted
+    m_transport->set_map_options({ .large_pages = m_map_options.large_pages });
+    return true;
+}
+
+glRemix::IPCCommandSpan glRemix::IPCProtocol::acquire_commands_or_wait(bool* frame_ended)
 {
+    if (m_lease_cursor != m_read_cursor)
+    {
+        // this is a logic error as leases never overlap
+        throw std::logic_error("IPCProtocol.READER - Previous lease was not released.");
+    }
+
+    *frame_ended = false;
+
+    wait_until(m_control->reader_waiting, m_write_signal,
+               [this]
+               {
+                   return m_control->write_cursor.load(std::memory_order_acquire) != m_read_cursor
+                          || has_pending_events()
+                          || m_control->streams_signaled.load(std::memory_order_acquire) != 0;
+               });
+
+    const UINT32 published = m_control->write_cursor.load(std::memory_order_acquire);
+
+    IPCCommandSpan span;
+    UINT32 cursor = m_read_cursor;
+
+    // lease one contiguous run of plain records, markers in front of it are consumed on the way
+    bool done = false;
+    while (cursor != published && !done)
     {
-        MemorySlot* oldest;  // shared memory that has the smaller recorded time frame
-        MemorySlot* latest;  // shared memory that has the larger recorded time frame
-        if (m_slot_A < m_slot_B)
+        const UINT32 position = cursor & (m_capacity - 1);
+        const UINT32 tail_bytes = m_capacity - position;
+
+        // the last record ended exactly at the ring end, the next one is at the start
+        if (position == 0 && span.bytes > 0)
         {
-            oldest = &m_slot_A;
-            latest = &m_slot_B;
+            break;
         }
-        else
+
+        // not even a header fits before the end, writer skipped ahead to the ring start
+        if (tail_bytes < sizeof(GLCommandHeader))
         {
-            oldest = &m_slot_B;
-            latest = &m_slot_A;
+            if (span.bytes > 0)
+            {
+                break;  // the lease can't cross the ring end
+            }
+            cursor += tail_bytes;
+            continue;
         }
 
-        HANDLE tmp_events[2] = { oldest->smem.get_write_event(), latest->smem.get_write_event() };
-
-        DWORD dw_wait_result = WaitForMultipleObjects(2, tmp_events, false, INFINITE);
+        const auto* header = reinterpret_cast<const GLCommandHeader*>(m_data + position);
+        const UINT32 record_bytes = align_u32(header->get_bytes() + header->get_cmd_bytes(),
+                                              k_IPC_RECORD_ALIGNMENT);
 
-        switch (dw_wait_result)
+        switch (header->get_type())
         {
-            case WAIT_OBJECT_0: m_curr_slot = oldest; break;
-            case WAIT_OBJECT_0 + 1:
-                m_curr_slot = latest;
-                DBG_PRINT("IPCProtocol.READER - Latest SharedMemory slot became available to read "
-                          "before oldest.");
-                break;  // theoretically should not occur
+            case GLCommandType::IPCCMD_WRAP:
+                if (span.bytes > 0)
+                {
+                    done = true;
+                    break;
+                }
+                cursor += tail_bytes;
+                break;
+            case GLCommandType::IPCCMD_FRAME_BEGIN:
+                if (span.bytes > 0)
+                {
+                    done = true;
+                    break;
+                }
+                m_frame_index = static_cast<const GLFrameHeader*>(header->get_payload())
+                                    ->frame_index;
+                cursor += record_bytes;
+                break;
+            case GLCommandType::IPCCMD_FRAME_END:
+                m_bulk_consumed = static_cast<const GLFrameHeader*>(header->get_payload())
+                                      ->bulk_cursor;
+                *frame_ended = true;
+                done = true;
+                cursor += record_bytes;
+                break;
+            case GLCommandType::IPCCMD_OVERFLOW:
+            {
+                done = true;
+                if (span.bytes > 0)
+                {
+                    break;
+                }
+
+                const auto* ref = static_cast<const IPCOverflowRef*>(header->get_payload());
+                if (ref->segment >= k_IPC_MAX_OVERFLOW_SEGMENTS)
+                {
+                    // this is a logic error as the writer never hands out such a segment
+                    throw std::logic_error(
+                        FSTR("IPCProtocol.READER - Invalid overflow segment {}", ref->segment));
+                }
+
+                char name[64];
+                snprintf(name, sizeof(name), k_OVERFLOW_MAP_FORMAT, ref->segment,
+                         ref->generation);
+                if (!m_transport->open_region(stream_name(name).c_str(), ref->record_bytes,
+                                              &m_lease_region))
+                {
+                    throw std::runtime_error(FSTR(
+                        "IPCProtocol.READER - Failed to open overflow segment {}", ref->segment));
+                }
+
+                span = { m_lease_region.data, ref->record_bytes };
+                m_lease_segment = ref->segment;
+                cursor += record_bytes;
+                break;
+            }
             default:
-                // this is a runtime_error as it is unpredictable to my knowledge
-                throw std::runtime_error(FSTR(
-                    "IPCProtocol.READER - WaitForMultipleObjects for reader failed. Error Code: {}",
-                    dw_wait_result));
+                if (span.bytes == 0)
+                {
+                    span.data = reinterpret_cast<const UINT8*>(header);
+                }
+                span.bytes += record_bytes;
+                cursor += record_bytes;
+                break;
+        }
+    }
+
+    m_lease_cursor = cursor;
+    m_lease_frame_ended = *frame_ended;
+    return span;
+}
+
+void glRemix::IPCProtocol::release_commands()
+{
+    if (m_lease_segment != k_IPC_MAX_OVERFLOW_SEGMENTS)
+    {
+        m_transport->close_region(&m_lease_region);
+
+        // writer may reuse the segment from here on
+        m_control->overflow_busy[m_lease_segment].store(0, std::memory_order_release);
+        m_lease_segment = k_IPC_MAX_OVERFLOW_SEGMENTS;
+    }
+
+    // hand the space back to the writer
+    m_read_cursor = m_lease_cursor;
+    m_control->read_cursor.store(m_read_cursor, std::memory_order_seq_cst);
+    if (m_lease_frame_ended)
+    {
+        m_control->frames_consumed.fetch_add(1, std::memory_order_seq_cst);
+        m_lease_frame_ended = false;
+    }
+
+    wake(m_control->writer_waiting, m_read_signal);
+}
+
+bool glRemix::IPCProtocol::has_commands() const
+{
+    return m_control && m_control->write_cursor.load(std::memory_order_acquire) != m_read_cursor;
+}
+
+bool glRemix::IPCProtocol::drop_stale_frame()
+{
+    if (m_control->frame_policy.load(std::memory_order_relaxed)
+        != static_cast<UINT32>(IPCFramePolicy::MAILBOX))
+    {
+        return false;
+    }
+
+    // the frame just consumed is already counted, anything still published is newer and complete
+    const UINT32 published = m_control->frames_published.load(std::memory_order_acquire);
+    const UINT32 consumed = m_control->frames_consumed.load(std::memory_order_relaxed);
+    if (published == consumed)
+    {
+        return false;
+    }
+
+    m_control->frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+glRemix::IPCFrameStats glRemix::IPCProtocol::get_frame_stats() const
+{
+    if (!m_control)
+    {
+        return {};
+    }
+
+    return { .writer_blocked_ns = m_control->writer_blocked_ns.load(std::memory_order_relaxed),
+             .writer_blocked_count = m_control->writer_blocked_count.load(
+                 std::memory_order_relaxed),
+             .publisher_blocked_ns = m_control->publisher_blocked_ns.load(
+                 std::memory_order_relaxed),
+             .publisher_blocked_count = m_control->publisher_blocked_count.load(
+                 std::memory_order_relaxed),
+             .frames_dropped = m_control->frames_dropped.load(std::memory_order_relaxed),
+             .frames_in_flight = m_control->frames_published.load(std::memory_order_relaxed)
+                                 - m_control->frames_consumed.load(std::memory_order_relaxed),
+             .writer_spin_hits = m_control->writer_spin_hits.load(std::memory_order_relaxed),
+             .writer_sleeps = m_control->writer_sleeps.load(std::memory_order_relaxed),
+             .reader_spin_hits = m_control->reader_spin_hits.load(std::memory_order_relaxed),
+             .reader_sleeps = m_control->reader_sleeps.load(std::memory_order_relaxed),
+             .replies_dropped = m_control->replies_dropped.load(std::memory_order_relaxed),
+             .bulk_view_remaps = m_control->bulk_view_remaps.load(std::memory_order_relaxed),
+             .events_dropped = m_control->events_dropped.load(std::memory_order_relaxed),
+             .streams_open = m_control->streams_open.load(std::memory_order_relaxed),
+             .commands_elided = m_control->commands_elided.load(std::memory_order_relaxed),
+             .bytes_elided = m_control->bytes_elided.load(std::memory_order_relaxed) };
+}
+
+void glRemix::IPCProtocol::report_elided_commands(const UINT32 commands, const UINT32 bytes)
+{
+    if (m_control)
+    {
+        m_control->commands_elided.store(commands, std::memory_order_relaxed);
+        m_control->bytes_elided.store(bytes, std::memory_order_relaxed);
+    }
+}
+
+UINT8* glRemix::IPCProtocol::reserve_bulk(const UINT32 bytes, GLBulkHandle* handle)
+{
+    *handle = {};
+
+    // a window has to hold the allocation plus the alignment slack in front of it
+    const UINT32 max_bytes = m_bulk_window > 0 ? m_bulk_window - k_IPC_VIEW_ALIGNMENT
+                                               : k_IPC_BULK_CAPACITY;
+    if (!m_control || bytes < k_IPC_MIN_BULK_BYTES || bytes > max_bytes || !is_writer_thread())
+    {
+        return nullptr;
+    }
+    // the publisher stamps the arena cursor into frames the game has already moved past
+    if (m_publisher.joinable())
+    {
+        return nullptr;
+    }
+
+    const UINT32 size = align_u32(bytes, k_IPC_BULK_ALIGNMENT);
+    const UINT32 position = m_bulk_cursor & (k_IPC_BULK_CAPACITY - 1);
+    const UINT32 tail_bytes = k_IPC_BULK_CAPACITY - position;
+    const UINT32 skip = size > tail_bytes ? tail_bytes : 0;  // allocations never wrap
+
+    // never wait here, the renderer only frees the arena between frames
+    const UINT32 used = m_bulk_cursor
+                        - m_control->bulk_read_cursor.load(std::memory_order_acquire);
+    if (used + skip + size > k_IPC_BULK_CAPACITY)
+    {
+        return nullptr;
+    }
+
+    const UINT32 offset = (m_bulk_cursor + skip) & (k_IPC_BULK_CAPACITY - 1);
+    UINT8* data = map_bulk(offset, size);
+    if (!data)
+    {
+        return nullptr;
+    }
+
+    m_bulk_cursor += skip + size;
+    *handle = { .offset = offset, .bytes = bytes };
+    return data;
+}
+
+// Returns the writer's address of arena bytes [offset, offset + bytes), moving a windowed view
+// forward when they fall outside it. Allocations never wrap, so a window never needs to either.
+UINT8* glRemix::IPCProtocol::map_bulk(const UINT32 offset, const UINT32 bytes)
+{
+    if (!m_bulk.data || offset < m_bulk.view_offset
+        || offset + bytes > m_bulk.view_offset + m_bulk.view_bytes)
+    {
+        const UINT32 view_offset = offset & ~(k_IPC_VIEW_ALIGNMENT - 1);
+        const UINT32 view_bytes = std::min(m_bulk_window, k_IPC_BULK_CAPACITY - view_offset);
+        if (!m_transport->remap_view(&m_bulk, view_offset, view_bytes))
+        {
+            // address space is tight, payloads go inline until a later remap succeeds
+            DBG_PRINT("IPCProtocol.WRITER - Could not map bulk window at %u.", view_offset);
+            return nullptr;
+        }
+        m_control->bulk_view_remaps.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return m_bulk.data + (offset - m_bulk.view_offset);
+}
+
+const UINT8* glRemix::IPCProtocol::get_bulk_data(const GLBulkHandle& handle) const
+{
+    if (handle.bytes > k_IPC_BULK_CAPACITY - handle.offset)
+    {
+        // this is a logic error as the writer only hands out handles inside the arena
+        throw std::logic_error(FSTR("IPCProtocol.READER - Bulk handle [{}, +{}) is out of range.",
+                                    handle.offset, handle.bytes));
+    }
+
+    return m_bulk.data + handle.offset;
+}
+
+void glRemix::IPCProtocol::release_bulk()
+{
+    m_control->bulk_read_cursor.store(m_bulk_consumed, std::memory_order_release);
+}
+
+bool glRemix::IPCProtocol::is_content_acknowledged(const UINT64 hash) const
+{
+    if (hash == 0 || hash == k_IPC_CONTENT_RETRACTED || !m_content_acks.data)
+    {
+        return false;
+    }
+
+    const auto* table = reinterpret_cast<const IPCContentAckTable*>(m_content_acks.data);
+    for (UINT32 probe = 0; probe < k_IPC_CONTENT_ACK_PROBES; probe++)
+    {
+        const UINT32 slot = static_cast<UINT32>(hash + probe) & (k_IPC_CONTENT_ACK_SLOTS - 1);
+        const UINT64 value = table->slots[slot].load(std::memory_order_acquire);
+        if (value == hash)
+        {
+            return true;
+        }
+        if (value == 0)
+        {
+            return false;  // retracted slots stay non-empty, so the probe sequence ends here
+        }
+    }
+    return false;
+}
+
+void glRemix::IPCProtocol::acknowledge_content(const UINT64 hash)
+{
+    if (hash == 0 || hash == k_IPC_CONTENT_RETRACTED)
+    {
+        return;
+    }
+
+    // only the reader writes the table, the writer just looks
+    auto* table = reinterpret_cast<IPCContentAckTable*>(m_content_acks.data);
+    std::atomic<UINT64>* free_slot = nullptr;
+    for (UINT32 probe = 0; probe < k_IPC_CONTENT_ACK_PROBES; probe++)
+    {
+        const UINT32 slot = static_cast<UINT32>(hash + probe) & (k_IPC_CONTENT_ACK_SLOTS - 1);
+        const UINT64 value = table->slots[slot].load(std::memory_order_relaxed);
+        if (value == hash)
+        {
+            return;
+        }
+        if (value == k_IPC_CONTENT_RETRACTED && !free_slot)
+        {
+            free_slot = &table->slots[slot];  // reused once the hash isn't further along
+        }
+        if (value == 0)
+        {
+            free_slot = free_slot ? free_slot : &table->slots[slot];
+            break;
+        }
+    }
+
+    if (free_slot)
+    {
+        free_slot->store(hash, std::memory_order_release);
+    }
+    // else the table is crowded around this hash, the writer keeps sending the full payload
+}
+
+void glRemix::IPCProtocol::retract_content(const UINT64 hash)
+{
+    if (hash == 0 || hash == k_IPC_CONTENT_RETRACTED)
+    {
+        return;
+    }
+
+    auto* table = reinterpret_cast<IPCContentAckTable*>(m_content_acks.data);
+    for (UINT32 probe = 0; probe < k_IPC_CONTENT_ACK_PROBES; probe++)
+    {
+        const UINT32 slot = static_cast<UINT32>(hash + probe) & (k_IPC_CONTENT_ACK_SLOTS - 1);
+        const UINT64 value = table->slots[slot].load(std::memory_order_relaxed);
+        if (value == hash)
+        {
+            // seq_cst, `get_retraction_fence` must not read the frame count before this lands
+            table->slots[slot].store(k_IPC_CONTENT_RETRACTED, std::memory_order_seq_cst);
+            return;
         }
+        if (value == 0)
+        {
+            return;
+        }
+    }
+}
+
+UINT32 glRemix::IPCProtocol::get_retraction_fence() const
+{
+    // the frame being recorded plus, with a publisher, the one handed over but not yet published
+    return m_control->frames_published.load(std::memory_order_seq_cst) + 2;
+}
+
+bool glRemix::IPCProtocol::has_consumed(const UINT32 fence) const
+{
+    const UINT32 consumed = m_control->frames_consumed.load(std::memory_order_acquire);
+    return static_cast<INT32>(consumed - fence) >= 0;
+}
+
+void glRemix::IPCProtocol::push_reply(const IPCReply& reply)
+{
+    const UINT32 write = m_control->reply_write_cursor.load(std::memory_order_relaxed);
+    const UINT32 read = m_control->reply_read_cursor.load(std::memory_order_acquire);
+    if (write - read >= k_IPC_REPLY_SLOTS)
+    {
+        // the shim hasn't drained in a while, never wait on the game for a correction
+        m_control->replies_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    m_control->replies[write & (k_IPC_REPLY_SLOTS - 1)] = reply;
+    m_control->reply_write_cursor.store(write + 1, std::memory_order_release);
+}
+
+bool glRemix::IPCProtocol::pop_reply(IPCReply* reply)
+{
+    if (!m_control)
+    {
+        return false;
+    }
+
+    const UINT32 read = m_control->reply_read_cursor.load(std::memory_order_relaxed);
+    if (read == m_control->reply_write_cursor.load(std::memory_order_acquire))
+    {
+        return false;
     }
 
-    thread_local GLFrameHeader frame_header;
+    *reply = m_control->replies[read & (k_IPC_REPLY_SLOTS - 1)];
+    m_control->reply_read_cursor.store(read + 1, std::memory_order_release);
+    return true;
+}
+
+void glRemix::IPCProtocol::push_event(const IPCEvent& event)
+{
+    if (!m_control)
+    {
+        return;
+    }
 
-    m_curr_slot->smem.read(&frame_header, 0, sizeof(GLFrameHeader));
+    const UINT32 write = m_control->event_write_cursor.load(std::memory_order_relaxed);
+    const UINT32 read = m_control->event_read_cursor.load(std::memory_order_acquire);
+    if (write - read >= k_IPC_EVENT_SLOTS)
+    {
+        // the renderer is stuck somewhere, never stall the game's window procedure on it
+        m_control->events_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
 
-    *frame_index = frame_header.frame_index;
-    *frame_bytes = frame_header.frame_bytes;
+    m_control->events[write & (k_IPC_EVENT_SLOTS - 1)] = event;
+    m_control->event_write_cursor.store(write + 1, std::memory_order_seq_cst);
 
-    UINT32 payload_bytes_read = m_curr_slot->smem.read(payload, sizeof(GLFrameHeader), *frame_bytes);
+    wake(m_control->reader_waiting, m_write_signal);
+}
 
-    if (payload_bytes_read != *frame_bytes)
+bool glRemix::IPCProtocol::pop_event(IPCEvent* event)
+{
+    if (!has_pending_events())
     {
-        // this is a logic error as this should really never happen.
-        // if it occurs, writer logic is incorrect
-        throw std::logic_error(FSTR("IPCProtocol.READER - Tried to read {} but only read {}",
-                                    *frame_bytes, payload_bytes_read));
+        return false;
     }
 
-    m_curr_slot->smem.signal_read_event();
+    const UINT32 read = m_control->event_read_cursor.load(std::memory_order_relaxed);
+    *event = m_control->events[read & (k_IPC_EVENT_SLOTS - 1)];
+    m_control->event_read_cursor.store(read + 1, std::memory_order_release);
+    return true;
+}
+
+bool glRemix::IPCProtocol::has_pending_events() const
+{
+    return m_control
+           && m_control->event_read_cursor.load(std::memory_order_relaxed)
+                  != m_control->event_write_cursor.load(std::memory_order_acquire);
+}
+
+void glRemix::IPCProtocol::open_stream(const UINT32 stream)
+{
+    // a stream starts out in its own share group, the reader finds it after the group is set
+    m_control->share_groups[stream].store(stream, std::memory_order_relaxed);
+    m_control->streams_open.fetch_or(1u << stream, std::memory_order_release);
+}
+
+void glRemix::IPCProtocol::set_share_group(const UINT32 stream, const UINT32 group)
+{
+    m_control->share_groups[stream].store(group, std::memory_order_release);
+}
+
+UINT32 glRemix::IPCProtocol::get_share_group(const UINT32 stream) const
+{
+    return m_control ? m_control->share_groups[stream].load(std::memory_order_acquire) : stream;
+}
+
+UINT32 glRemix::IPCProtocol::get_open_streams() const
+{
+    return m_control ? m_control->streams_open.load(std::memory_order_acquire) : 0;
+}
+
+UINT32 glRemix::IPCProtocol::take_signaled_streams()
+{
+    return m_control ? m_control->streams_signaled.exchange(0, std::memory_order_acq_rel) : 0;
+}
+
+void glRemix::IPCProtocol::signal_stream(const UINT32 stream)
+{
+    m_control->streams_signaled.fetch_or(1u << stream, std::memory_order_seq_cst);
+    wake(m_control->reader_waiting, m_write_signal);
+}
+
+void glRemix::IPCProtocol::write_simple(const void* ptr, const SIZE_T bytes)
+{
+    if (!write_thread_record(ptr, bytes))
+    {
+        write_record(ptr, bytes);
+    }
 }
 
-void glRemix::IPCProtocol::write_simple(const void* ptr, SIZE_T bytes)
+void glRemix::IPCProtocol::write_record(const void* ptr, const SIZE_T bytes)
 {
-    m_curr_slot->smem.write(ptr, m_offset, bytes);
-    m_offset += bytes;
+    if (bytes > m_record_remaining)
+    {
+        // this is a logic error as the caller passed a wrong `extra_data_bytes` to write_command
+        throw std::logic_error(
+            FSTR("IPCProtocol.WRITER - Writing {} bytes overruns the reserved command record.",
+                 bytes));
+    }
+
+    memcpy(m_record_ptr, ptr, bytes);
+    m_record_ptr += bytes;
+    m_record_remaining -= static_cast<UINT32>(bytes);
 }
@@ -1,69 +1,351 @@
 #pragma once
 
-#include <windows.h>
+#include "platform.h"
 
 #include "gl_commands.h"
-#include "shared_memory.h"
+#include "ipc_ring.h"
+#include "ipc_transport.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
 
 namespace glRemix
 {
-// Local keyword allows to stay per-session, Global requires elevated permissions
-// wchar_t is standard for file mapping names in windows (though can maybe switch with TCHAR*)
-constexpr const wchar_t* k_MAP_A = L"Local\\glRemix_Map_A";
-constexpr const wchar_t* k_WRITE_EVENT_A = L"Local\\glRemix_WriteEvent_A";
-constexpr const wchar_t* k_READ_EVENT_A = L"Local\\glRemix_ReadEvent_A";
+// transport object names, each backend adds its own namespace prefix
+constexpr const char* k_RING_MAP = "glRemix_Ring";
+constexpr const char* k_RING_WRITE_EVENT = "glRemix_Ring_WriteEvent";  // data published
+constexpr const char* k_RING_READ_EVENT = "glRemix_Ring_ReadEvent";    // space/frame freed
+constexpr const char* k_CONTENT_ACK_MAP = "glRemix_ContentAcks";
+constexpr const char* k_BULK_MAP = "glRemix_Bulk";
+// formatted with segment index and generation
+constexpr const char* k_OVERFLOW_MAP_FORMAT = "glRemix_Overflow_%u_%u";
+// every stream but 0 appends this to its names, the content acks are shared by all streams
+constexpr const char* k_STREAM_SUFFIX_FORMAT = "_%u";
 
-constexpr const wchar_t* k_MAP_B = L"Local\\glRemix_Map_B";
-constexpr const wchar_t* k_WRITE_EVENT_B = L"Local\\glRemix_WriteEvent_B";
-constexpr const wchar_t* k_READ_EVENT_B = L"Local\\glRemix_ReadEvent_B";
+// snapshot of the counters in the ring control block
+struct IPCFrameStats
+{
+    UINT64 writer_blocked_ns = 0;  // the game thread's stalls, publisher or not
+    UINT64 writer_blocked_count = 0;
+    UINT64 publisher_blocked_ns = 0;  // the publisher's ring waits, the game records meanwhile
+    UINT64 publisher_blocked_count = 0;
+    UINT64 frames_dropped = 0;
+    UINT32 frames_in_flight = 0;  // published but not yet consumed
+    UINT64 writer_spin_hits = 0;  // waits resolved by spinning vs. sleeping on the signal
+    UINT64 writer_sleeps = 0;
+    UINT64 reader_spin_hits = 0;
+    UINT64 reader_sleeps = 0;
+    UINT32 replies_dropped = 0;  // back-channel replies lost to a full reply ring
+    UINT64 bulk_view_remaps = 0;
+    UINT32 events_dropped = 0;  // window messages lost to a full event ring
+    UINT32 streams_open = 0;    // bit per GL context stream
+    UINT32 commands_elided = 0;  // state calls the shim dropped in its last frame
+    UINT32 bytes_elided = 0;
+};
+
+struct IPCThreadBuffer;  // see `IPCProtocol::set_writer_thread`
 
-constexpr UINT32 k_MAX_IPC_PAYLOAD = k_DEFAULT_CAPACITY - sizeof(GLFrameHeader);
+// read-only view of complete command records, decoded in place
+struct IPCCommandSpan
+{
+    const UINT8* data = nullptr;
+    UINT32 bytes = 0;
+};
 
-// For now, a simple manager for `SharedMemory
+/*
+ * Single-producer/single-consumer command stream over one shared memory ring.
+ * The shim records commands straight into the ring and publishes its write cursor as it goes,
+ * so the renderer can decode a frame while the shim is still recording it.
+ * Frames are delimited by `IPCCMD_FRAME_BEGIN` / `IPCCMD_FRAME_END` markers in the stream.
+ * Records too large for the ring (or large ones arriving while it is full) are written to named
+ * overflow segments and referenced from the ring with `IPCCMD_OVERFLOW`, so nothing is dropped.
+ * All OS access goes through an `IPCTransport`, the default one is the platform backend.
+ * Waits spin on the shared cursors for an adaptive budget before sleeping on a signal.
+ * One thread writes the ring, other threads may record too and are merged in at frame end.
+ */
 class IPCProtocol
 {
 public:
+    IPCProtocol();
+    explicit IPCProtocol(std::unique_ptr<IPCTransport> transport);
+    ~IPCProtocol();
+
+    IPCProtocol(const IPCProtocol&) = delete;
+    IPCProtocol& operator=(const IPCProtocol&) = delete;
+
     // for shim
     void init_writer();
-    void start_frame_or_wait();  // uses `WaitForMultipleObjects` to stall thread here
 
     /*
-     * Writes `GLFrameHeader` at 0 offset of IPC file-mapped object.
-     * Signals write event when complete
+     * Call before `init_writer` / `init_reader`, see `IPCMapOptions`. Prefaulting only applies to
+     * the ring, the bulk arena and the ack table; overflow segments are short lived and mostly
+     * partially used, so faulting them in up front costs more than it saves.
+     */
+    inline void set_map_options(const IPCMapOptions& options)
+    {
+        m_map_options = options;
+    }
+
+    /*
+     * Call before `init_writer`. Maps only `window_bytes` of the bulk arena (a multiple of
+     * `k_IPC_VIEW_ALIGNMENT`, 0 maps all of it) and moves that view along with the bulk cursor,
+     * so 32-bit games give up a few MB of address space instead of the whole arena.
+     * Payloads that don't fit a window go inline. The reader always maps the whole arena.
+     */
+    void set_bulk_window(UINT32 window_bytes);
+
+    /*
+     * Call before `init_writer` / `init_reader`. Every GL context records into its own stream, all
+     * but stream 0 get their own ring, signals and bulk arena. A writer given `directory` (stream
+     * 0's protocol) flags its stream there whenever it publishes, which wakes stream 0's reader.
+     */
+    void set_stream(UINT32 stream, IPCProtocol* directory = nullptr);
+
+    inline UINT32 get_stream() const
+    {
+        return m_stream;
+    }
+
+    /*
+     * The calling thread records straight into the ring from now on, and is the only one that may
+     * start and end frames. Until a thread calls this the first one to record claims the stream.
+     * Every other thread appends to a thread-local buffer without locking. `end_frame` merges
+     * those records in the order they were recorded, after the writer thread's own.
+     * Their payloads always go inline, the bulk arena belongs to the writer thread.
+     */
+    void set_writer_thread();
+    bool is_writer_thread();  // claims the stream if no thread has yet
+
+    /*
+     * Optional, call after `init_writer`. A publisher thread takes over the ring: the writer
+     * thread records into its thread buffer like any other, `end_frame` hands the frame over and
+     * `start_frame_or_wait` returns right away. The publisher copies the frame into the ring,
+     * publishes it and starts the next one, waiting on the renderer in the game's place.
+     * Double buffered, `end_frame` only blocks while the previous frame is still being copied.
+     * The renderer sees a frame once it is complete rather than while it is recorded.
+     */
+    void start_publisher();
+
+    // may be called before or after `init_writer`, `queue_depth` only applies to FIFO
+    void set_frame_policy(IPCFramePolicy policy, UINT32 queue_depth = k_IPC_MAX_FRAMES_AHEAD);
+
+    // blocks while the frame policy allows no more frames in flight, then emits the begin marker
+    void start_frame_or_wait();
+
+    /*
+     * Emits the frame end marker and publishes everything recorded so far.
+     * Signals write event if the reader is waiting.
      */
     void end_frame();
 
+    /*
+     * Carves `bytes` out of the bulk arena for a payload a command refers to by `handle`.
+     * Like `write_simple` data it must be filled before the next command is recorded, since that
+     * is when the command carrying `handle` gets published, and before the next `reserve_bulk`,
+     * which may move a windowed view.
+     * Returns nullptr (and an empty handle) for small payloads, while the renderer still holds
+     * too much of the arena, or with a publisher thread; the payload then goes inline as before.
+     */
+    UINT8* reserve_bulk(UINT32 bytes, GLBulkHandle* handle);
+
     // for renderer
     void init_reader();
-    // uses `WaitForMultipleObjects` to stall thread here. signals read event when complete.
-    void consume_frame_or_wait(void* payload, UINT32* frame_index, UINT32* frame_bytes);
+
+    /*
+     * Blocks until records are published, then leases a run of complete commands straight out of
+     * the ring (or one overflow segment). The span may be empty if only markers were consumed.
+     * The writer won't reuse the leased memory until `release_commands`, so anything needed past
+     * that point must be copied out. Sets `frame_ended` once the frame end marker was consumed.
+     * Also returns (with an empty span) when events are pending or other streams were signaled,
+     * so the caller can drain them while a slow frame is still being recorded.
+     */
+    IPCCommandSpan acquire_commands_or_wait(bool* frame_ended);
+    void release_commands();
+
+    // true if `acquire_commands_or_wait` would not block
+    bool has_commands() const;
+
+    /*
+     * Call after consuming a whole frame. In mailbox mode returns true (and counts a drop) when a
+     * newer frame is already complete, so the caller should not present the one just decoded.
+     */
+    bool drop_stale_frame();
+
+    IPCFrameStats get_frame_stats() const;
+
+    // writer, what the shim's state filter saved in the frame about to end
+    void report_elided_commands(UINT32 commands, UINT32 bytes);
+
+    /*
+     * Bulk payloads of consumed frames stay valid until `release_bulk`, so uploads can read them
+     * in place after the command lease is gone. Releases everything up to the last frame end.
+     */
+    const UINT8* get_bulk_data(const GLBulkHandle& handle) const;
+    void release_bulk();
+
+    /*
+     * Content cache handshake. The reader acknowledges a content hash once it has cached that
+     * payload, from then on the writer may reference it by hash alone. The reader retracts the
+     * hash before it drops the payload, records already written may still reference it.
+     */
+    bool is_content_acknowledged(UINT64 hash) const;  // writer
+    void acknowledge_content(UINT64 hash);            // reader
+    void retract_content(UINT64 hash);                // reader
+
+    /*
+     * Reader, right after `retract_content`. Records the writer wrote before it saw the
+     * retraction belong at the latest to the frame it is recording, or with a publisher to the
+     * one after. Once `has_consumed` the returned fence, no record can reference the content.
+     */
+    UINT32 get_retraction_fence() const;
+    bool has_consumed(UINT32 fence) const;
+
+    /*
+     * Back-channel for the shim's mirrored GL state, so queries never wait on the renderer.
+     * The reader pushes corrections (errors, real limits, failed textures) without blocking,
+     * replies that don't fit are dropped and counted. The writer drains them when it likes.
+     */
+    void push_reply(const IPCReply& reply);  // reader
+    bool pop_reply(IPCReply* reply);         // writer
+
+    /*
+     * Out-of-band window messages (input, focus), so they reach the renderer without waiting for
+     * the frame they were recorded in. The writer pushes without blocking, events that don't fit
+     * are dropped and counted. Wakes the reader if it is waiting for commands.
+     */
+    void push_event(const IPCEvent& event);  // writer
+    bool pop_event(IPCEvent* event);         // reader
+
+    /*
+     * Stream directory, called on stream 0's protocol from any thread. Writers open a stream once
+     * its ring is initialized and move it into another stream's share group for `wglShareLists`,
+     * the reader opens every stream it finds and decodes those that were signaled.
+     */
+    void open_stream(UINT32 stream);                    // writer
+    void set_share_group(UINT32 stream, UINT32 group);  // writer
+    UINT32 get_share_group(UINT32 stream) const;        // either side
+    UINT32 get_open_streams() const;                    // reader
+    UINT32 take_signaled_streams();                     // reader
+
+    // frame index of the frame currently being consumed
+    inline UINT32 get_frame_index() const
+    {
+        return m_frame_index;
+    }
 
     void write_simple(const void* ptr, SIZE_T bytes);
 
+    // completes the record of the last `reserve`, see there
+    void commit();
+
 #include "ipc_protocol.inl"
 
 private:
-    struct MemorySlot
-    {
-        SharedMemory smem;
-        UINT32 frame_index = 0;  // each smem keeps track of their own frame index for now
+    std::unique_ptr<IPCTransport> m_transport;
+
+    IPCRegion m_ring;
+    IPCSignal m_write_signal;  // writer -> reader, data published
+    IPCSignal m_read_signal;   // reader -> writer, space or frame released
+    IPCRingControl* m_control = nullptr;
+    IPCRegion m_content_acks;
+    IPCRegion m_bulk;
+    IPCMapOptions m_map_options;
+    UINT8* m_data = nullptr;  // first byte of the command ring
+    UINT32 m_capacity = 0;
+
+    UINT32 m_frame_index = 0;
+
+    UINT32 m_spin_limit;  // adaptive, see `wait_until`
+
+    // writer
+    IPCFramePolicy m_frame_policy = IPCFramePolicy::LOCK_STEP;
+    UINT32 m_queue_depth = k_IPC_MAX_FRAMES_AHEAD;
 
-        inline bool operator<(const MemorySlot& other) const
-        {
-            return frame_index < other.frame_index;
-        }
+    struct OverflowSegment
+    {
+        IPCRegion region;  // `capacity` is 0 while the segment is released
+        UINT32 generation = 0;
+        UINT32 last_used_frame = 0;
     };
 
-    // double buffers
-    MemorySlot m_slot_A;
-    MemorySlot m_slot_B;
+    std::array<OverflowSegment, k_IPC_MAX_OVERFLOW_SEGMENTS> m_overflow;
+
+    UINT32 m_frame_bytes = 0;       // command bytes recorded this frame, excluding markers
+    UINT32 m_write_cursor = 0;      // end of the reserved region
+    UINT32 m_published_cursor = 0;  // last value stored into `write_cursor`
+    UINT32 m_seen_read_cursor = 0;  // last value loaded from `read_cursor`
+    UINT32 m_fast_bytes = 0;        // ring bytes `reserve` may take inline, see `update_fast_bytes`
+    UINT32 m_bulk_cursor = 0;       // end of the bulk arena allocations
+    UINT32 m_bulk_window = 0;       // bytes of the arena mapped at once, 0 while mapped whole
+
+    // remaining space of the record currently being written, in the ring or an overflow segment
+    UINT8* m_record_ptr = nullptr;
+    UINT32 m_record_remaining = 0;
+
+    void begin_frame();
+    void finish_frame(UINT64 sequence_limit);
+    UINT8* reserve_record(GLCommandType type, UINT32 command_bytes, UINT32 extra_data_bytes);
+    IPCThreadBuffer* begin_thread_record(UINT32 payload_bytes);
+    void begin_ring_record(UINT32 payload_bytes);
+    void write_record(const void* ptr, SIZE_T bytes);
+    void write_marker(GLCommandType type, const GLFrameHeader& header);
+    UINT8* reserve_ring_record(UINT32 record_bytes);
+    bool ring_has_space(UINT32 bytes);
+    bool has_free_space(UINT32 bytes);
+    void update_fast_bytes();
+    UINT8* spill_record(UINT32 record_bytes);
+    UINT32 acquire_overflow_segment(UINT32 bytes);
+    void trim_overflow_segments();
+    UINT8* map_bulk(UINT32 offset, UINT32 bytes);
+    void publish(bool force);
+    void wait_for_space(UINT32 bytes);
+
+    // records of threads other than the writer thread
+    std::atomic<std::thread::id> m_writer_thread;
+    std::atomic<IPCThreadBuffer*> m_thread_buffers = nullptr;  // never shrinks, one per thread
+    std::atomic<UINT64> m_record_sequence = 0;                 // orders them across threads
+
+    IPCThreadBuffer* get_thread_buffer();
+    bool write_thread_record(const void* ptr, SIZE_T bytes);
+    void merge_thread_records(UINT64 sequence_limit);
+
+    // publisher, see `start_publisher`
+    std::thread m_publisher;
+    std::atomic<bool> m_publisher_stop = false;
+    std::atomic<UINT32> m_frames_submitted = 0;  // handed over by the writer thread
+    std::atomic<UINT32> m_frames_retired = 0;    // copied into the ring by the publisher
+    UINT64 m_submitted_sequence = 0;             // records before this belong to the handed frame
+
+    void hand_off_frame();
+    void run_publisher();
+
+    template<typename Predicate>
+    void wait_until(std::atomic<UINT32>& waiting, const IPCSignal& signal, Predicate ready);
+    void wake(const std::atomic<UINT32>& waiting, const IPCSignal& signal);
+    static void count_blocked(std::atomic<UINT64>& blocked_ns, std::atomic<UINT64>& blocked_count,
+                              std::chrono::steady_clock::time_point start);
 
-    UINT32 g_frame_index = 0;
+    bool open_ring_for_reader();
+    bool has_pending_events() const;
+    std::string stream_name(const char* name) const;
+    void signal_stream(UINT32 stream);
 
-    MemorySlot* m_curr_slot = nullptr;
+    UINT32 m_stream = 0;
+    IPCProtocol* m_directory = nullptr;  // stream 0, flagged on publish
 
-    UINT32 m_offset = 0;
+    // reader
+    UINT32 m_read_cursor = 0;   // start of the current lease
+    UINT32 m_lease_cursor = 0;  // end of the current lease, becomes `read_cursor` on release
+    bool m_lease_frame_ended = false;
+    UINT32 m_lease_segment = k_IPC_MAX_OVERFLOW_SEGMENTS;  // overflow segment held by the lease
+    IPCRegion m_lease_region;
+    UINT32 m_bulk_consumed = 0;  // bulk cursor of the last frame end consumed
 };
 }  // namespace glRemix
@@ -1,3 +1,49 @@
+/*
+ * Reserves the whole record with one capacity check, writes its header and returns the slot of
+ * the command, which the caller fills in place. The `extra_data_bytes` behind it follow through
+ * `write_simple`, before or after `commit`. Nothing else may be recorded on this thread until the
+ * record is committed, and the slot is only `k_IPC_RECORD_ALIGNMENT` aligned.
+ * The payload type comes from `gl_commands.schema`, only `trailing` commands take extra data.
+ */
+template<glRemix::GLCommandType Type>
+inline typename glRemix::GLCommandTraits<Type>::Payload* reserve(const UINT32 extra_data_bytes = 0)
+{
+    using GLCommand = typename glRemix::GLCommandTraits<Type>::Payload;
+    static_assert(std::is_trivially_copyable_v<GLCommand>);
+
+    if constexpr (!glRemix::GLCommandTraits<Type>::k_TRAILING_DATA)
+    {
+        if (extra_data_bytes != 0)
+        {
+            throw std::logic_error("IPCProtocol.WRITER - Extra data on a fixed size command.");
+        }
+    }
+
+    // writer thread records that fit in `m_fast_bytes` skip the out of line checks
+    if (!m_publisher.joinable()
+        && m_writer_thread.load(std::memory_order_acquire) == std::this_thread::get_id()
+        && extra_data_bytes < m_fast_bytes)
+    {
+        const UINT32 payload_bytes = sizeof(GLCommand) + extra_data_bytes;
+        const UINT32 bytes = sizeof(GLCommandHeader) + payload_bytes;
+        const UINT32 record_bytes = align_u32(bytes, k_IPC_RECORD_ALIGNMENT);
+        if (record_bytes <= m_fast_bytes)
+        {
+            UINT8* record = m_data + (m_write_cursor & (m_capacity - 1));
+            m_write_cursor += record_bytes;
+            m_fast_bytes -= record_bytes;
+            m_frame_bytes += bytes;
+
+            GLCommandHeader::write(reinterpret_cast<UINT32*>(record), Type, payload_bytes);
+            m_record_ptr = record + sizeof(GLCommandHeader) + sizeof(GLCommand);
+            m_record_remaining = record_bytes - (sizeof(GLCommandHeader) + sizeof(GLCommand));
+            return reinterpret_cast<GLCommand*>(record + sizeof(GLCommandHeader));
+        }
+    }
+
+    return reinterpret_cast<GLCommand*>(reserve_record(Type, sizeof(GLCommand), extra_data_bytes));
+}
+
 /**
  * @brief Helper function to write a `GLCommand` to IPC.
  * The last 3 arguments are relevant for GL functions that accept a pointer,
@@ -7,9 +53,11 @@
  * `false` and `nullptr` respectively, and those pointers may be written one-by-one
  * using calls to `IPCProtocol::write_simple`.
  * See `gl_draw_arrays_ovr` in `glRemixShim/gl_hooks.cpp` for such an use case.
+ * The whole record is reserved contiguously up front (in the ring or an overflow segment),
+ * so every later `write_simple` for this command must stay within `extra_data_bytes`.
+ * Hooks that build the command field by field can use `reserve` and `commit` directly.
  *
- * @tparam GLCommand
- * @param type
+ * @tparam Type: the payload type is `GLCommandTraits<Type>::Payload`
  * @param command
  * @param extra_data_bytes: Can be > 0 even if `has_extra_data` is `false`.
  * i.e. should ALWAYS be set to the total desired byte size of extra data associated with this
@@ -18,32 +66,21 @@
  * @param has_extra_data: whether contents of `p_extra_data == nullptr`.
  * @param p_extra_data: pointer to extra data
  */
-template<typename GLCommand>
-inline void write_command(glRemix::GLCommandType type, const GLCommand& command,
+template<glRemix::GLCommandType Type>
+inline void write_command(const typename glRemix::GLCommandTraits<Type>::Payload& command,
                           const UINT32 extra_data_bytes = 0, bool has_extra_data = false,
                           const void* p_extra_data = nullptr)
 {
-    if (!m_curr_slot)
-    {
-        throw std::logic_error("IPCProtocol.WRITER - `m_curr_slot` is null at time of writing.");
-    }
+    using GLCommand = typename glRemix::GLCommandTraits<Type>::Payload;
+
     if (has_extra_data && (!p_extra_data || extra_data_bytes == 0))
     {
         throw std::logic_error("IPCProtocol.WRITER - Incorrect usage of `write_command`.");
     }
 
-    const UINT32 command_bytes = sizeof(GLCommand);
-
-    constexpr const SIZE_T header_bytes = sizeof(GLCommandHeader);
-
-    // always write `total_bytes`
-    const SIZE_T total_bytes = command_bytes + extra_data_bytes;
-
-    GLCommandHeader header = { type, static_cast<UINT32>(total_bytes) };
-
-    this->write_simple(&header, header_bytes);
-
-    this->write_simple(&command, command_bytes);
+    GLCommand* slot = this->reserve<Type>(extra_data_bytes);
+    memcpy(slot, &command, sizeof(GLCommand));
+    this->commit();
 
     if (has_extra_data)
     {
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "platform.h"
+
+#include "math_utils.h"
+
+#include <atomic>
+
+namespace glRemix
+{
+constexpr UINT32 k_IPC_RING_MAGIC = 0x474C5252;  // 'GLRR'
+constexpr UINT32 k_IPC_RING_VERSION = 14;
+
+// must stay a power of two so monotonic UINT32 cursors wrap cleanly onto ring positions
+// kept small and hot, large records spill into overflow segments instead
+constexpr UINT32 k_IPC_RING_CAPACITY = 4 * MEGABYTE;
+
+// records larger than this always go to an overflow segment
+constexpr UINT32 k_IPC_MAX_RING_RECORD = k_IPC_RING_CAPACITY / 4;
+
+// records at least this large spill instead of waiting when the ring is currently full
+constexpr UINT32 k_IPC_MIN_SPILL_BYTES = 64 * 1024;
+
+// overflow segments are named mappings owned by the writer and reused across frames
+constexpr UINT32 k_IPC_MAX_OVERFLOW_SEGMENTS = 16;
+constexpr UINT32 k_IPC_MIN_OVERFLOW_CAPACITY = 4 * MEGABYTE;
+constexpr UINT32 k_IPC_OVERFLOW_IDLE_FRAMES = 120;  // unused segments are released after this
+
+// texture pixels and client arrays go to a separate arena so the ring only holds small records
+// must stay a power of two, allocations are carved off a monotonic cursor like the ring
+constexpr UINT32 k_IPC_BULK_CAPACITY = 16 * MEGABYTE;
+constexpr UINT32 k_IPC_BULK_ALIGNMENT = 16;
+constexpr UINT32 k_IPC_MIN_BULK_BYTES = 1024;  // smaller payloads are cheaper to keep inline
+
+// every record (header + payload) starts on this boundary
+constexpr UINT32 k_IPC_RECORD_ALIGNMENT = 4;
+
+// writer publishes its cursor once this many bytes of complete commands are pending
+constexpr UINT32 k_IPC_PUBLISH_BYTES = 4 * 1024;
+
+// writer may run this many published frames ahead of the reader (matches the old A/B slots)
+constexpr UINT32 k_IPC_MAX_FRAMES_AHEAD = 2;
+
+// waits spin on the shared cursors this many iterations before sleeping on the signal,
+// the budget adapts between the bounds: spin hits grow it, waits that end up sleeping halve it
+constexpr UINT32 k_IPC_MIN_SPIN = 64;
+constexpr UINT32 k_IPC_INITIAL_SPIN = 4096;
+constexpr UINT32 k_IPC_MAX_SPIN = 64 * 1024;
+
+// upper bound for `IPCFramePolicy::FIFO` queue depths
+constexpr UINT32 k_IPC_MAX_QUEUE_DEPTH = 16;
+
+// one stream (ring, signals, bulk arena) per GL context, stream 0 carries the presented window
+constexpr UINT32 k_IPC_MAX_STREAMS = 8;
+
+// threads recording into a stream they don't own buffer records in chunks of at least this size
+constexpr UINT32 k_IPC_THREAD_CHUNK_BYTES = 64 * 1024;
+
+// how far the game may run ahead of the renderer, chosen by the writer
+enum class IPCFramePolicy : UINT32
+{
+    LOCK_STEP,  // blocks while `k_IPC_MAX_FRAMES_AHEAD` frames are in flight (default)
+    FIFO,       // blocks while `queue_depth` frames are in flight
+    MAILBOX,    // never waits for the reader, which drops every frame a newer one has replaced
+};
+
+// renderer -> shim corrections for the shim's mirrored GL state, see `IPCProtocol::push_reply`
+enum class IPCReplyType : UINT32
+{
+    GL_ERROR,         // `value` is an error the renderer raised while decoding
+    INTEGER,          // `name` is a `glGetIntegerv` pname, `value` the renderer's real value
+    TEXTURE_INVALID,  // `name` is a texture the renderer could not create
+};
+
+struct IPCReply
+{
+    IPCReplyType type;
+    UINT32 name;
+    INT32 value;
+};
+
+constexpr UINT32 k_IPC_REPLY_SLOTS = 64;  // power of two, replies that don't fit are dropped
+
+// shim -> renderer window message, sent outside the frame stream, see `IPCProtocol::push_event`
+struct IPCEvent
+{
+    UINT32 msg;
+    UINT64 wparam;
+    UINT64 lparam;
+};
+
+constexpr UINT32 k_IPC_EVENT_SLOTS = 64;  // power of two, events that don't fit are dropped
+
+/*
+ * Lives at the start of the ring mapping, the command ring follows at `k_IPC_RING_CONTROL_BYTES`.
+ * Cursors are monotonic byte counts, ring position is `cursor & (capacity - 1)`.
+ * Writer and reader fields sit on separate cache lines to avoid false sharing.
+ */
+struct IPCRingControl
+{
+    std::atomic<UINT32> magic;  // written last by the writer once the rest is initialized
+    UINT32 version;
+    UINT32 wire_version;  // `k_GLCMD_WIRE_VERSION` of the writer's command records
+    UINT32 capacity;
+
+    // writer owned
+    alignas(64) std::atomic<UINT32> write_cursor;  // end of complete, published records
+    std::atomic<UINT32> frames_published;
+    std::atomic<UINT32> writer_waiting;  // writer is blocked on the read event
+    std::atomic<UINT32> frame_policy;    // `IPCFramePolicy`
+
+    // reader owned
+    alignas(64) std::atomic<UINT32> read_cursor;  // writer may overwrite everything before this
+    std::atomic<UINT32> frames_consumed;
+    std::atomic<UINT32> reader_waiting;    // reader is blocked on the write event
+    std::atomic<UINT32> bulk_read_cursor;  // writer may reuse the bulk arena before this
+
+    // counters, each written by one side only
+    alignas(64) std::atomic<UINT64> writer_blocked_ns;  // game time lost waiting on the renderer
+    std::atomic<UINT64> writer_blocked_count;
+    std::atomic<UINT64> publisher_blocked_ns;  // ring waits of the publisher thread, if any
+    std::atomic<UINT64> publisher_blocked_count;
+    std::atomic<UINT64> frames_dropped;    // frames the reader skipped in mailbox mode
+    std::atomic<UINT64> writer_spin_hits;  // waits that were satisfied while spinning
+    std::atomic<UINT64> writer_sleeps;     // waits that fell back to the signal
+    std::atomic<UINT64> reader_spin_hits;
+    std::atomic<UINT64> reader_sleeps;
+    std::atomic<UINT64> bulk_view_remaps;  // times a windowed writer moved its bulk view
+    std::atomic<UINT32> commands_elided;   // redundant state calls dropped in the last frame
+    std::atomic<UINT32> bytes_elided;
+
+    // set by the writer when it fills a segment, cleared by the reader once copied out
+    alignas(64) std::atomic<UINT32> overflow_busy[k_IPC_MAX_OVERFLOW_SEGMENTS];
+
+    // reply ring, the reader produces and the writer consumes, cursors are monotonic slot counts
+    alignas(64) std::atomic<UINT32> reply_write_cursor;  // reader owned
+    std::atomic<UINT32> replies_dropped;
+    alignas(64) std::atomic<UINT32> reply_read_cursor;  // writer owned
+    alignas(64) IPCReply replies[k_IPC_REPLY_SLOTS];
+
+    // event ring, the writer produces and the reader consumes, independent of frame hand-off
+    alignas(64) std::atomic<UINT32> event_write_cursor;  // writer owned
+    std::atomic<UINT32> events_dropped;
+    alignas(64) std::atomic<UINT32> event_read_cursor;  // reader owned
+    alignas(64) IPCEvent events[k_IPC_EVENT_SLOTS];
+
+    // stream directory, only stream 0's is used. writers of every context update it concurrently,
+    // `streams_signaled` marks streams that published since the reader last looked
+    alignas(64) std::atomic<UINT32> streams_open;  // bit per stream with an initialized ring
+    std::atomic<UINT32> streams_signaled;
+    std::atomic<UINT32> share_groups[k_IPC_MAX_STREAMS];  // stream whose namespaces it uses
+};
+
+// content hashes the reader has cached, the writer may then send just the hash
+// open addressed, 0 marks an empty slot and `k_IPC_CONTENT_RETRACTED` one whose hash was removed
+constexpr UINT32 k_IPC_CONTENT_ACK_SLOTS = 8192;   // power of two
+constexpr UINT32 k_IPC_CONTENT_ACK_PROBES = 32;    // beyond this a hash is simply not acknowledged
+constexpr UINT64 k_IPC_CONTENT_RETRACTED = ~0ull;  // never acknowledged itself
+
+struct IPCContentAckTable
+{
+    std::atomic<UINT64> slots[k_IPC_CONTENT_ACK_SLOTS];
+};
+
+// payload of `IPCCMD_OVERFLOW`, the actual record lives at the start of the named segment
+struct IPCOverflowRef
+{
+    UINT32 segment;
+    UINT32 generation;    // bumped whenever the writer recreates the segment
+    UINT32 record_bytes;  // padded size of the record (header + payload)
+};
+
+static_assert(std::atomic<UINT32>::is_always_lock_free,
+              "IPC ring cursors must be lock-free to be shared across processes");
+static_assert(std::atomic<UINT64>::is_always_lock_free,
+              "IPC ring counters must be lock-free to be shared across processes");
+
+constexpr UINT32 k_IPC_RING_CONTROL_BYTES = 4096;
+static_assert(sizeof(IPCRingControl) <= k_IPC_RING_CONTROL_BYTES);
+}  // namespace glRemix
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "platform.h"
+
+#include <memory>
+
+namespace glRemix
+{
+/*
+ * A named block of memory visible to both sides, backends keep their own bookkeeping in `native`.
+ * `data` points at the mapped view, which covers the whole region unless it was created windowed.
+ */
+struct IPCRegion
+{
+    UINT8* data = nullptr;
+    UINT32 capacity = 0;
+    void* native = nullptr;
+    UINT32 view_offset = 0;  // region byte `data` points at
+    UINT32 view_bytes = 0;   // bytes mapped at `data`
+};
+
+// How regions are backed, set before the first region is created or opened
+struct IPCMapOptions
+{
+    bool prefault = false;     // fault every page in up front so early frames don't pay for it
+    bool large_pages = false;  // ask for large pages where the OS allows, else normal pages
+    UINT32 view_bytes = 0;     // created regions map only this much at first, 0 maps them whole
+};
+
+// regions are touched in steps of the smallest page size
+constexpr UINT32 k_IPC_PAGE_BYTES = 4096;
+
+// view offsets must be a multiple of this, the Windows allocation granularity
+constexpr UINT32 k_IPC_VIEW_ALIGNMENT = 64 * 1024;
+
+/*
+ * Faults in every page of `region`. Only the creator may write, as nobody else can be using
+ * the memory yet; an opener just reads, which maps the already backed pages into its view.
+ */
+inline void prefault_region(const IPCRegion& region, const bool write)
+{
+    volatile UINT8* data = region.data;
+    UINT8 sink = 0;
+    for (UINT32 offset = 0; offset < region.view_bytes; offset += k_IPC_PAGE_BYTES)
+    {
+        if (write)
+        {
+            data[offset] = 0;  // regions start zeroed, this keeps them so
+        }
+        else
+        {
+            sink ^= data[offset];
+        }
+    }
+    (void)sink;
+}
+
+// A named auto-reset wakeup shared by both sides
+struct IPCSignal
+{
+    void* native = nullptr;
+};
+
+/*
+ * The OS facilities `IPCProtocol` needs: named shared regions and wakeup signals.
+ * Writers create (the region starts zeroed), readers open. Names are plain identifiers,
+ * backends add whatever prefix their namespace requires.
+ */
+class IPCTransport
+{
+public:
+    virtual ~IPCTransport() = default;
+
+    virtual bool create_region(const char* name, UINT32 capacity, IPCRegion* out) = 0;
+    virtual bool open_region(const char* name, UINT32 capacity, IPCRegion* out) = 0;
+    virtual void close_region(IPCRegion* region) = 0;
+
+    /*
+     * Replaces the view of `region` with `bytes` starting at `offset` (a multiple of
+     * `k_IPC_VIEW_ALIGNMENT`), so a 32-bit process can walk a large region through a small window.
+     * Returns false if the new view can't be mapped, `data` is then null until the next remap.
+     */
+    virtual bool remap_view(IPCRegion* region, UINT32 offset, UINT32 bytes) = 0;
+
+    virtual bool create_signal(const char* name, IPCSignal* out) = 0;
+    virtual bool open_signal(const char* name, IPCSignal* out) = 0;
+    virtual void close_signal(IPCSignal* signal) = 0;
+
+    /*
+     * Waiting is two-phase so a `notify` can never be lost: take a token, re-check the condition,
+     * then `wait` with the token. `wait` returns immediately if a notify happened since
+     * `prepare_wait`, and may also return spuriously. Returns false on an OS error.
+     */
+    virtual UINT32 prepare_wait(const IPCSignal& signal) = 0;
+    virtual bool wait(const IPCSignal& signal, UINT32 token) = 0;
+    virtual void notify(const IPCSignal& signal) = 0;
+
+    virtual const char* get_name() const = 0;
+
+    // applies to regions created or opened afterwards, backends ignore what they can't provide
+    void set_map_options(const IPCMapOptions& options)
+    {
+        m_map_options = options;
+    }
+
+protected:
+    IPCMapOptions m_map_options;
+};
+
+// Win32 file mappings + events on Windows, POSIX shm + futex on Linux
+std::unique_ptr<IPCTransport> create_platform_transport();
+
+// Heap memory + std::atomic waits, both sides must live in the same process
+std::unique_ptr<IPCTransport> create_loopback_transport();
+
+#ifndef _WIN32
+// Available on Linux only
+std::unique_ptr<IPCTransport> create_posix_transport();
+#else
+std::unique_ptr<IPCTransport> create_win32_transport();
+#endif
+}  // namespace glRemix
@@ -0,0 +1,184 @@
+#include "ipc_transport.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+// page aligned like a real mapping, so the ring control block gets its cache line alignment
+constexpr std::align_val_t k_REGION_ALIGNMENT{ 4096 };
+
+struct LoopbackBlock
+{
+    UINT8* data = nullptr;
+    UINT32 capacity = 0;
+
+    explicit LoopbackBlock(const UINT32 bytes) : capacity(bytes)
+    {
+        data = static_cast<UINT8*>(::operator new(bytes, k_REGION_ALIGNMENT));
+        memset(data, 0, bytes);
+    }
+
+    ~LoopbackBlock()
+    {
+        ::operator delete(data, k_REGION_ALIGNMENT);
+    }
+
+    LoopbackBlock(const LoopbackBlock&) = delete;
+    LoopbackBlock& operator=(const LoopbackBlock&) = delete;
+};
+
+// Process wide namespace standing in for the kernel object namespace
+struct LoopbackRegistry
+{
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<LoopbackBlock>> regions;
+    std::unordered_map<std::string, std::shared_ptr<std::atomic<UINT32>>> signals;
+};
+
+LoopbackRegistry& s_registry()
+{
+    static LoopbackRegistry registry;
+    return registry;
+}
+
+class LoopbackTransport final : public glRemix::IPCTransport
+{
+public:
+    bool create_region(const char* name, const UINT32 capacity, glRemix::IPCRegion* out) override
+    {
+        auto block = std::make_shared<LoopbackBlock>(capacity);
+        {
+            LoopbackRegistry& registry = s_registry();
+            std::scoped_lock lock(registry.mutex);
+            registry.regions[name] = block;  // replaces a stale block, holders keep theirs alive
+        }
+        attach(std::move(block), out);
+
+        // the whole block stays addressable, a window only limits what the caller may touch
+        if (m_map_options.view_bytes > 0 && m_map_options.view_bytes < capacity)
+        {
+            out->view_bytes = m_map_options.view_bytes;
+        }
+        return true;
+    }
+
+    bool open_region(const char* name, const UINT32 capacity, glRemix::IPCRegion* out) override
+    {
+        std::shared_ptr<LoopbackBlock> block;
+        {
+            LoopbackRegistry& registry = s_registry();
+            std::scoped_lock lock(registry.mutex);
+            if (const auto it = registry.regions.find(name); it != registry.regions.end())
+            {
+                block = it->second;
+            }
+        }
+        if (!block || block->capacity < capacity)
+        {
+            return false;
+        }
+        return attach(std::move(block), out);
+    }
+
+    void close_region(glRemix::IPCRegion* region) override
+    {
+        delete static_cast<std::shared_ptr<LoopbackBlock>*>(region->native);
+        *region = {};
+    }
+
+    bool remap_view(glRemix::IPCRegion* region, const UINT32 offset, const UINT32 bytes) override
+    {
+        const auto& block = *static_cast<std::shared_ptr<LoopbackBlock>*>(region->native);
+        if (offset % glRemix::k_IPC_VIEW_ALIGNMENT != 0 || offset > block->capacity
+            || bytes > block->capacity - offset)
+        {
+            region->data = nullptr;
+            return false;
+        }
+
+        region->data = block->data + offset;
+        region->view_offset = offset;
+        region->view_bytes = bytes;
+        return true;
+    }
+
+    bool create_signal(const char* name, glRemix::IPCSignal* out) override
+    {
+        auto word = std::make_shared<std::atomic<UINT32>>(0);
+        {
+            LoopbackRegistry& registry = s_registry();
+            std::scoped_lock lock(registry.mutex);
+            registry.signals[name] = word;
+        }
+        out->native = new std::shared_ptr<std::atomic<UINT32>>(std::move(word));
+        return true;
+    }
+
+    bool open_signal(const char* name, glRemix::IPCSignal* out) override
+    {
+        LoopbackRegistry& registry = s_registry();
+        std::scoped_lock lock(registry.mutex);
+        const auto it = registry.signals.find(name);
+        if (it == registry.signals.end())
+        {
+            return false;
+        }
+        out->native = new std::shared_ptr<std::atomic<UINT32>>(it->second);
+        return true;
+    }
+
+    void close_signal(glRemix::IPCSignal* signal) override
+    {
+        delete static_cast<std::shared_ptr<std::atomic<UINT32>>*>(signal->native);
+        *signal = {};
+    }
+
+    UINT32 prepare_wait(const glRemix::IPCSignal& signal) override
+    {
+        return s_word(signal).load(std::memory_order_acquire);
+    }
+
+    bool wait(const glRemix::IPCSignal& signal, const UINT32 token) override
+    {
+        s_word(signal).wait(token, std::memory_order_acquire);
+        return true;
+    }
+
+    void notify(const glRemix::IPCSignal& signal) override
+    {
+        s_word(signal).fetch_add(1, std::memory_order_release);
+        s_word(signal).notify_all();
+    }
+
+    const char* get_name() const override
+    {
+        return "loopback";
+    }
+
+private:
+    static std::atomic<UINT32>& s_word(const glRemix::IPCSignal& signal)
+    {
+        return **static_cast<std::shared_ptr<std::atomic<UINT32>>*>(signal.native);
+    }
+
+    static bool attach(std::shared_ptr<LoopbackBlock> block, glRemix::IPCRegion* out)
+    {
+        out->data = block->data;
+        out->capacity = block->capacity;
+        out->view_offset = 0;
+        out->view_bytes = block->capacity;
+        out->native = new std::shared_ptr<LoopbackBlock>(std::move(block));
+        return true;
+    }
+};
+}  // namespace
+
+std::unique_ptr<glRemix::IPCTransport> glRemix::create_loopback_transport()
+{
+    return std::make_unique<LoopbackTransport>();
+}
@@ -0,0 +1,263 @@
+#include "ipc_transport.h"
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <string>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr UINT32 k_HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+struct PosixMapping
+{
+    std::string name;
+    int fd = -1;
+    size_t bytes = 0;
+    bool owner = false;  // creator unlinks the name on close
+};
+
+std::string s_object_name(const char* name)
+{
+    return std::string("/") + name;
+}
+
+// Shared (non-private) futex ops so both processes wake each other through the same page
+long s_futex(std::atomic<UINT32>* word, const int op, const UINT32 value)
+{
+    return syscall(SYS_futex, reinterpret_cast<UINT32*>(word), op, value, nullptr, nullptr, 0);
+}
+
+class PosixTransport final : public glRemix::IPCTransport
+{
+public:
+    bool create_region(const char* name, const UINT32 capacity, glRemix::IPCRegion* out) override
+    {
+        return map(s_object_name(name), capacity, true, out);
+    }
+
+    bool open_region(const char* name, const UINT32 capacity, glRemix::IPCRegion* out) override
+    {
+        return map(s_object_name(name), capacity, false, out);
+    }
+
+    void close_region(glRemix::IPCRegion* region) override
+    {
+        auto* mapping = static_cast<PosixMapping*>(region->native);
+        if (mapping)
+        {
+            if (region->data)
+            {
+                munmap(region->data, mapping->bytes);
+            }
+            close(mapping->fd);
+            if (mapping->owner)
+            {
+                shm_unlink(mapping->name.c_str());
+            }
+            delete mapping;
+        }
+        *region = {};
+    }
+
+    bool remap_view(glRemix::IPCRegion* region, const UINT32 offset, const UINT32 bytes) override
+    {
+        auto* mapping = static_cast<PosixMapping*>(region->native);
+        if (region->data)
+        {
+            munmap(region->data, mapping->bytes);
+            region->data = nullptr;
+        }
+
+        if (offset % glRemix::k_IPC_VIEW_ALIGNMENT != 0 || offset > region->capacity
+            || bytes > region->capacity - offset)
+        {
+            return false;
+        }
+
+        // windows are moved right before they are filled, populating them beats faulting per page
+        void* view = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          mapping->fd, offset);
+        if (view == MAP_FAILED)
+        {
+            DBG_PRINT("PosixTransport - mmap(%s, +%u) failed. Error Code: %d",
+                      mapping->name.c_str(), offset, errno);
+            return false;
+        }
+
+        region->data = static_cast<UINT8*>(view);
+        region->view_offset = offset;
+        region->view_bytes = bytes;
+        mapping->bytes = bytes;
+        return true;
+    }
+
+    // a signal is a futex word in its own tiny region, the word counts notifies
+    bool create_signal(const char* name, glRemix::IPCSignal* out) override
+    {
+        return map_signal(name, true, out);
+    }
+
+    bool open_signal(const char* name, glRemix::IPCSignal* out) override
+    {
+        return map_signal(name, false, out);
+    }
+
+    void close_signal(glRemix::IPCSignal* signal) override
+    {
+        auto* region = static_cast<glRemix::IPCRegion*>(signal->native);
+        if (region)
+        {
+            close_region(region);
+            delete region;
+        }
+        *signal = {};
+    }
+
+    UINT32 prepare_wait(const glRemix::IPCSignal& signal) override
+    {
+        return s_word(signal)->load(std::memory_order_acquire);
+    }
+
+    bool wait(const glRemix::IPCSignal& signal, const UINT32 token) override
+    {
+        // returns at once with EAGAIN if a notify bumped the word since `prepare_wait`
+        if (s_futex(s_word(signal), FUTEX_WAIT, token) == 0)
+        {
+            return true;
+        }
+        return errno == EAGAIN || errno == EINTR;
+    }
+
+    void notify(const glRemix::IPCSignal& signal) override
+    {
+        s_word(signal)->fetch_add(1, std::memory_order_release);
+        s_futex(s_word(signal), FUTEX_WAKE, INT_MAX);
+    }
+
+    const char* get_name() const override
+    {
+        return "posix";
+    }
+
+private:
+    static std::atomic<UINT32>* s_word(const glRemix::IPCSignal& signal)
+    {
+        return reinterpret_cast<std::atomic<UINT32>*>(
+            static_cast<glRemix::IPCRegion*>(signal.native)->data);
+    }
+
+    bool map_signal(const char* name, const bool create, glRemix::IPCSignal* out)
+    {
+        auto* region = new glRemix::IPCRegion();
+        const bool mapped = create ? create_region(name, sizeof(std::atomic<UINT32>), region)
+                                   : open_region(name, sizeof(std::atomic<UINT32>), region);
+        if (!mapped)
+        {
+            delete region;
+            return false;
+        }
+        out->native = region;
+        return true;
+    }
+
+    bool map(const std::string& name, const UINT32 capacity, const bool create,
+             glRemix::IPCRegion* out) const
+    {
+        int fd = -1;
+        if (create)
+        {
+            shm_unlink(name.c_str());  // start from a zeroed object even if a stale one exists
+            fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd >= 0 && ftruncate(fd, capacity) != 0)
+            {
+                DBG_PRINT("PosixTransport - ftruncate(%s) failed. Error Code: %d", name.c_str(),
+                          errno);
+                close(fd);
+                shm_unlink(name.c_str());
+                return false;
+            }
+        }
+        else
+        {
+            fd = shm_open(name.c_str(), O_RDWR, 0600);
+
+            struct stat st = {};
+            if (fd >= 0 && (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(capacity)))
+            {
+                close(fd);  // not sized yet by the writer
+                return false;
+            }
+        }
+
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        // only the creating side maps windows, openers always see the whole region
+        const UINT32 view_bytes = create && m_map_options.view_bytes > 0
+                                      ? std::min(m_map_options.view_bytes, capacity)
+                                      : capacity;
+
+        // huge page advice has to land before the first fault, so those regions prefault by hand
+        const bool large_pages = m_map_options.large_pages && view_bytes >= k_HUGE_PAGE_BYTES;
+        const int flags = MAP_SHARED | (m_map_options.prefault && !large_pages ? MAP_POPULATE : 0);
+
+        void* view = mmap(nullptr, view_bytes, PROT_READ | PROT_WRITE, flags, fd, 0);
+        if (view == MAP_FAILED)
+        {
+            DBG_PRINT("PosixTransport - mmap(%s) failed. Error Code: %d", name.c_str(), errno);
+            close(fd);
+            if (create)
+            {
+                shm_unlink(name.c_str());
+            }
+            return false;
+        }
+
+        out->data = static_cast<UINT8*>(view);
+        out->capacity = capacity;
+        out->native = new PosixMapping{ name, fd, view_bytes, create };
+        out->view_offset = 0;
+        out->view_bytes = view_bytes;
+
+        if (large_pages)
+        {
+            // shm only gets transparent huge pages if shmem_enabled allows `advise`
+            if (madvise(view, view_bytes, MADV_HUGEPAGE) != 0)
+            {
+                DBG_PRINT("PosixTransport - madvise(%s, MADV_HUGEPAGE) failed. Error Code: %d",
+                          name.c_str(), errno);
+            }
+            if (m_map_options.prefault)
+            {
+                glRemix::prefault_region(*out, create);
+            }
+        }
+        return true;
+    }
+};
+}  // namespace
+
+std::unique_ptr<glRemix::IPCTransport> glRemix::create_posix_transport()
+{
+    return std::make_unique<PosixTransport>();
+}
+
+std::unique_ptr<glRemix::IPCTransport> glRemix::create_platform_transport()
+{
+    return create_posix_transport();
+}
+
+#endif
@@ -0,0 +1,148 @@
+#include "ipc_transport.h"
+
+#ifdef _WIN32
+
+#include "shared_memory.h"
+
+#include <string>
+
+namespace
+{
+// Local keyword allows to stay per-session, Global requires elevated permissions
+std::wstring s_object_name(const char* name)
+{
+    std::wstring wide = L"Local\\";
+    for (const char* c = name; *c; c++)
+    {
+        wide.push_back(static_cast<wchar_t>(*c));  // names are plain ASCII identifiers
+    }
+    return wide;
+}
+
+class Win32Transport final : public glRemix::IPCTransport
+{
+public:
+    bool create_region(const char* name, const UINT32 capacity, glRemix::IPCRegion* out) override
+    {
+        return map_region(name, capacity, true, out);
+    }
+
+    bool open_region(const char* name, const UINT32 capacity, glRemix::IPCRegion* out) override
+    {
+        return map_region(name, capacity, false, out);
+    }
+
+    void close_region(glRemix::IPCRegion* region) override
+    {
+        delete static_cast<glRemix::SharedMemory*>(region->native);  // unmaps and closes
+        *region = {};
+    }
+
+    bool remap_view(glRemix::IPCRegion* region, const UINT32 offset, const UINT32 bytes) override
+    {
+        auto* smem = static_cast<glRemix::SharedMemory*>(region->native);
+        if (offset % glRemix::k_IPC_VIEW_ALIGNMENT != 0 || offset > region->capacity
+            || bytes > region->capacity - offset || !smem->remap_view(offset, bytes))
+        {
+            region->data = nullptr;
+            return false;
+        }
+
+        region->data = smem->get_data();
+        region->view_offset = offset;
+        region->view_bytes = bytes;
+        return true;
+    }
+
+    bool create_signal(const char* name, glRemix::IPCSignal* out) override
+    {
+        // auto-reset so a signal raised before the wait is remembered
+        out->native = CreateEventW(nullptr, false, false, s_object_name(name).c_str());
+        return out->native != nullptr;
+    }
+
+    bool open_signal(const char* name, glRemix::IPCSignal* out) override
+    {
+        out->native = OpenEventW(EVENT_ALL_ACCESS, FALSE, s_object_name(name).c_str());
+        return out->native != nullptr;
+    }
+
+    void close_signal(glRemix::IPCSignal* signal) override
+    {
+        if (signal->native)
+        {
+            CloseHandle(signal->native);
+        }
+        *signal = {};
+    }
+
+    UINT32 prepare_wait(const glRemix::IPCSignal&) override
+    {
+        return 0;  // auto-reset events already latch notifies
+    }
+
+    bool wait(const glRemix::IPCSignal& signal, UINT32) override
+    {
+        return WaitForSingleObject(signal.native, INFINITE) == WAIT_OBJECT_0;
+    }
+
+    void notify(const glRemix::IPCSignal& signal) override
+    {
+        SetEvent(signal.native);
+    }
+
+    const char* get_name() const override
+    {
+        return "win32";
+    }
+
+private:
+    bool map_region(const char* name, const UINT32 capacity, const bool create,
+                    glRemix::IPCRegion* out) const
+    {
+        auto* smem = new glRemix::SharedMemory();
+
+        // only the creating side maps windows, openers always see the whole region
+        const UINT32 view_bytes = create && m_map_options.view_bytes < capacity
+                                      ? m_map_options.view_bytes
+                                      : 0;  // 0 maps all
+
+        const std::wstring object_name = s_object_name(name);
+        const bool mapped = create
+                                ? smem->create_for_writer(object_name.c_str(), nullptr, nullptr,
+                                                          capacity, m_map_options.large_pages,
+                                                          view_bytes)
+                                : smem->open_for_reader(object_name.c_str(), nullptr, nullptr,
+                                                        capacity);
+        if (!mapped)
+        {
+            delete smem;
+            return false;
+        }
+
+        out->data = smem->get_data();
+        out->capacity = capacity;
+        out->native = smem;
+        out->view_offset = 0;
+        out->view_bytes = view_bytes > 0 ? view_bytes : capacity;
+
+        if (m_map_options.prefault)
+        {
+            glRemix::prefault_region(*out, create);
+        }
+        return true;
+    }
+};
+}  // namespace
+
+std::unique_ptr<glRemix::IPCTransport> glRemix::create_win32_transport()
+{
+    return std::make_unique<Win32Transport>();
+}
+
+std::unique_ptr<glRemix::IPCTransport> glRemix::create_platform_transport()
+{
+    return create_win32_transport();
+}
+
+#endif
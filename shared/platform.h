@@ -0,0 +1,76 @@
+#pragma once
+
+// Win32 types and debug helpers used throughout `shared/`.
+// Non-Windows builds get stand-ins so the IPC layer can be benchmarked and stress-tested on POSIX.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+typedef std::uint8_t UINT8;
+typedef std::uint16_t UINT16;
+typedef std::uint32_t UINT32;
+typedef std::uint64_t UINT64;
+typedef std::int32_t INT32;
+typedef std::int64_t INT64;
+typedef unsigned int UINT;
+typedef std::uint32_t DWORD;
+typedef int BOOL;
+typedef std::size_t SIZE_T;
+typedef void* HANDLE;
+typedef void* HWND;
+#endif
+
+#include <version>
+
+#ifdef __cpp_lib_format
+#include <format>
+
+#define FSTR(fmt, ...) std::format(fmt, __VA_ARGS__)
+#else
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace glRemix::detail
+{
+// Replaces each `{}` in order, enough for the error messages in this repo
+template<typename... Args>
+std::string format_fallback(std::string_view fmt, const Args&... args)
+{
+    std::ostringstream out;
+    auto append = [&](const auto& arg)
+    {
+        const size_t pos = fmt.find("{}");
+        out << fmt.substr(0, pos);
+        if (pos == std::string_view::npos)
+        {
+            fmt = {};
+            return;
+        }
+        out << arg;
+        fmt.remove_prefix(pos + 2);
+    };
+    (append(args), ...);
+    out << fmt;
+    return out.str();
+}
+}  // namespace glRemix::detail
+
+#define FSTR(fmt, ...) ::glRemix::detail::format_fallback(fmt, __VA_ARGS__)
+#endif
+
+#ifdef _WIN32
+#define DBG_PRINT(fmt, ...)                                                                        \
+    do                                                                                             \
+    {                                                                                              \
+        char _buf[256];                                                                            \
+        std::snprintf(_buf, sizeof(_buf), fmt "\n", __VA_ARGS__);                                  \
+        OutputDebugStringA(_buf);                                                                  \
+    } while (0)
+#else
+#define DBG_PRINT(fmt, ...) std::fprintf(stderr, fmt "\n", __VA_ARGS__)
+#endif
@@ -10,17 +10,27 @@ glRemix::SharedMemory::~SharedMemory()
 // `CreateFileMapping`
 bool glRemix::SharedMemory::create_for_writer(const wchar_t* map_name,
                                               const wchar_t* write_event_name,
-                                              const wchar_t* read_event_name)
+                                              const wchar_t* read_event_name,
+                                              const UINT32 capacity, const bool large_pages,
+                                              const UINT32 view_bytes)
 {
     close_all();
 
-    const auto h_map_file
-        = CreateFileMappingW(INVALID_HANDLE_VALUE,  // use paging file
-                             nullptr,               // default security
-                             PAGE_READWRITE,        // rw access
-                             0,                     // maximum object size (high-order DWORD)
-                             max_object_size(),     // maximum object size (low-order DWORD)
-                             map_name);             // name of mapping object
+    m_capacity = capacity;
+
+    HANDLE h_map_file = large_pages ? create_large_page_mapping(map_name) : nullptr;
+    const bool mapped_large = h_map_file != nullptr;
+
+    if (!h_map_file)
+    {
+        h_map_file
+            = CreateFileMappingW(INVALID_HANDLE_VALUE,  // use paging file
+                                 nullptr,               // default security
+                                 PAGE_READWRITE,        // rw access
+                                 0,                     // maximum object size (high-order DWORD)
+                                 max_object_size(),     // maximum object size (low-order DWORD)
+                                 map_name);             // name of mapping object
+    }
 
     if (!h_map_file)
     {
@@ -29,7 +39,11 @@ bool glRemix::SharedMemory::create_for_writer(const wchar_t* map_name,
         return false;
     }
 
-    if (!map_common(h_map_file))
+    // views of a large page section have to ask for large pages too
+    const DWORD access = mapped_large ? FILE_MAP_ALL_ACCESS | FILE_MAP_LARGE_PAGES
+                                      : FILE_MAP_ALL_ACCESS;
+
+    if (!map_common(h_map_file, access, view_bytes))
     {
         DBG_PRINT("SharedMemory.WRITER - Could not map common view. Error Code: %u", GetLastError());
 
@@ -37,19 +51,28 @@ bool glRemix::SharedMemory::create_for_writer(const wchar_t* map_name,
         return false;
     }
 
-    // create named events
-    m_write_event = CreateEventW(nullptr, false, false, write_event_name);
-    m_read_event = CreateEventW(nullptr, false, true, read_event_name);
+    // create named events, plain data segments pass no event names
+    if (write_event_name)
+    {
+        m_write_event = CreateEventW(nullptr, false, false, write_event_name);
+    }
+    if (read_event_name)
+    {
+        m_read_event = CreateEventW(nullptr, false, true, read_event_name);
+    }
 
     return true;
 }
 
 bool glRemix::SharedMemory::open_for_reader(const wchar_t* map_name,
                                             const wchar_t* write_event_name,
-                                            const wchar_t* read_event_name)
+                                            const wchar_t* read_event_name,
+                                            const UINT32 capacity)
 {
     close_all();
 
+    m_capacity = capacity;
+
     HANDLE h_map_file = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, map_name);
     if (!h_map_file)
     {
@@ -67,8 +90,14 @@ bool glRemix::SharedMemory::open_for_reader(const wchar_t* map_name,
     }
 
     // Try to open events (safe if they don't exist yet)
-    m_write_event = OpenEventW(EVENT_ALL_ACCESS, FALSE, write_event_name);
-    m_read_event = OpenEventW(EVENT_ALL_ACCESS, FALSE, read_event_name);
+    if (write_event_name)
+    {
+        m_write_event = OpenEventW(EVENT_ALL_ACCESS, FALSE, write_event_name);
+    }
+    if (read_event_name)
+    {
+        m_read_event = OpenEventW(EVENT_ALL_ACCESS, FALSE, read_event_name);
+    }
 
     return true;
 }
@@ -105,11 +134,58 @@ UINT32 glRemix::SharedMemory::read(void* dst, const UINT32 offset, const UINT32
     return bytes_read;
 }
 
-bool glRemix::SharedMemory::map_common(const HANDLE h_map_file)
+// Large page sections are nonpageable, so the process needs SeLockMemoryPrivilege enabled and
+// the size has to be a multiple of the large page size. Returns nullptr if either isn't possible.
+HANDLE glRemix::SharedMemory::create_large_page_mapping(const wchar_t* map_name)
 {
-    m_view = MapViewOfFile(h_map_file,           // handle to map object
-                           FILE_MAP_ALL_ACCESS,  // rw permission
-                           0, 0, 0);
+    const SIZE_T large_page = GetLargePageMinimum();
+    if (large_page == 0)
+    {
+        return nullptr;
+    }
+
+    HANDLE token = nullptr;
+    TOKEN_PRIVILEGES privileges = { .PrivilegeCount = 1 };
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    const bool enabled = OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token)
+                         && LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME,
+                                                  &privileges.Privileges[0].Luid)
+                         && AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr)
+                         && GetLastError() == ERROR_SUCCESS;  // not ERROR_NOT_ALL_ASSIGNED
+    if (token)
+    {
+        CloseHandle(token);
+    }
+    if (!enabled)
+    {
+        DBG_PRINT("SharedMemory.WRITER - SeLockMemoryPrivilege not held, using normal pages. "
+                  "Error Code: %u",
+                  GetLastError());
+        return nullptr;
+    }
+
+    const UINT64 bytes = (static_cast<UINT64>(m_capacity) + large_page - 1) / large_page
+                         * large_page;
+    HANDLE h_map_file = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr,
+                                           PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+                                           static_cast<DWORD>(bytes >> 32),
+                                           static_cast<DWORD>(bytes), map_name);
+    if (!h_map_file)
+    {
+        DBG_PRINT("SharedMemory.WRITER - Large page mapping failed, using normal pages. Error "
+                  "Code: %u",
+                  GetLastError());
+    }
+    return h_map_file;
+}
+
+bool glRemix::SharedMemory::map_common(const HANDLE h_map_file, const DWORD access,
+                                       const UINT32 view_bytes)
+{
+    m_view = MapViewOfFile(h_map_file,  // handle to map object
+                           access,      // rw permission
+                           0, 0,
+                           view_bytes);  // 0 maps the whole object
 
     if (m_view == nullptr)
     {
@@ -120,7 +196,29 @@ bool glRemix::SharedMemory::map_common(const HANDLE h_map_file)
 
     m_map = h_map_file;
     m_payload = reinterpret_cast<UINT8*>(m_view);
+    m_access = access;
+
+    return true;
+}
+
+bool glRemix::SharedMemory::remap_view(const UINT32 offset, const UINT32 bytes)
+{
+    if (m_view)
+    {
+        UnmapViewOfFile(m_view);
+        m_view = nullptr;
+        m_payload = nullptr;
+    }
+
+    m_view = MapViewOfFile(m_map, m_access, 0, offset, bytes);
+    if (m_view == nullptr)
+    {
+        DBG_PRINT("SharedMemory - `MapViewOfFile()` at offset %u failed. Error Code: %u", offset,
+                  GetLastError());
+        return false;
+    }
 
+    m_payload = reinterpret_cast<UINT8*>(m_view);
     return true;
 }
 
@@ -1,19 +1,9 @@
 #pragma once
 
-#include <windows.h>
+#include "platform.h"
 
 #include "math_utils.h"
 
-#define DBG_PRINT(fmt, ...)                                                                        \
-    do                                                                                             \
-    {                                                                                              \
-        char _buf[256];                                                                            \
-        std::snprintf(_buf, sizeof(_buf), fmt "\n", __VA_ARGS__);                                  \
-        OutputDebugStringA(_buf);                                                                  \
-    } while (0)
-
-#define FSTR(fmt, ...) std::format(fmt, __VA_ARGS__)
-
 namespace glRemix
 {
 constexpr UINT32 k_DEFAULT_CAPACITY = 16 * MEGABYTE;
@@ -25,12 +15,22 @@ public:
     ~SharedMemory();
 
     // writer creates or opens existing mapping and initializes frame header.
+    // event names may be null for plain data segments.
+    // `large_pages` needs SeLockMemoryPrivilege, the mapping falls back to normal pages without it
+    // `view_bytes` maps only the start of the mapping (0 maps all), see `remap_view`
     bool create_for_writer(const wchar_t* map_name, const wchar_t* write_event_name,
-                           const wchar_t* read_event_name);
+                           const wchar_t* read_event_name, UINT32 capacity = k_DEFAULT_CAPACITY,
+                           bool large_pages = false, UINT32 view_bytes = 0);
 
     // reader opens existing mapping and maps view.
     bool open_for_reader(const wchar_t* map_name, const wchar_t* write_event_name,
-                         const wchar_t* read_event_name);
+                         const wchar_t* read_event_name, UINT32 capacity = k_DEFAULT_CAPACITY);
+
+    // replaces the view with `bytes` at `offset`, which must be allocation granularity aligned
+    bool remap_view(UINT32 offset, UINT32 bytes);
+
+    // unmaps the view and closes every handle, safe to call repeatedly
+    void close_all();
 
     // returns true if write success
     bool write(const void* src, const UINT32 offset, const UINT32 bytes_to_write);
@@ -43,6 +43,12 @@ public:
         return m_capacity;
     }
 
+    // base of the mapped view, for callers that manage their own layout (e.g. the IPC ring)
+    inline UINT8* get_data() const
+    {
+        return m_payload;
+    }
+
     // accesssors
     inline HANDLE get_write_event() const
     {
@@ -68,17 +74,17 @@ private:
     HANDLE m_map = nullptr;  // windows provides `HANDLE` typedef
     LPVOID m_view = nullptr;
     UINT8* m_payload = nullptr;
+    DWORD m_access = FILE_MAP_ALL_ACCESS;  // views are remapped with the same access
 
-    // currently, this is never modified.
-    // Only foreseeable refactors is if we want to allow expansion of memory capacity
+    // set once when the mapping is created or opened
     UINT32 m_capacity = k_DEFAULT_CAPACITY;
 
     HANDLE m_write_event = nullptr;
     HANDLE m_read_event = nullptr;
 
     // helpers
-    bool map_common(HANDLE h_map);
-    void close_all();
+    bool map_common(HANDLE h_map, DWORD access = FILE_MAP_ALL_ACCESS, UINT32 view_bytes = 0);
+    HANDLE create_large_page_mapping(const wchar_t* map_name);
 
     inline DWORD max_object_size()
     {